@@ -0,0 +1,63 @@
+#include "reachability.h"
+
+#include <QFileInfo>
+
+Reachability::Reachability(const SharedPtr<Schema>& main_schema, const QMap<QString, SharedPtr<Schema>>& schemas)
+{
+    QList<SharedPtr<Schema>> queue = { main_schema };
+    _reachable.insert(main_schema->typeName(), main_schema);
+
+    for(int i = 0; i < queue.size(); i++)
+    {
+        for(const SharedPtr<Block>& block : queue[i]->blocks())
+        {
+            if (block->type() == BlockType::CUSTOM && !_reachable.contains(block->typeName()))
+            {
+                SharedPtr<Schema> schema = schemas.value(block->typeName());
+
+                if (schema)
+                {
+                    _reachable.insert(schema->typeName(), schema);
+                    queue.append(schema);
+                }
+            }
+        }
+    }
+
+    for(const QString& type_name : schemas.keys())
+    {
+        if (!_reachable.contains(type_name))
+        {
+            _unreachable.append(type_name);
+        }
+    }
+}
+
+Reachability::~Reachability()
+{
+}
+
+const QMap<QString, SharedPtr<Schema>>& Reachability::reachable() const
+{
+    return _reachable;
+}
+
+const QStringList& Reachability::unreachable() const
+{
+    return _unreachable;
+}
+
+qint64 Reachability::skippedBytes(const QMap<QString, SharedPtr<Schema>>& files) const
+{
+    qint64 bytes = 0;
+
+    for(auto it = files.constBegin(); it != files.constEnd(); ++it)
+    {
+        if (!_reachable.contains(it.value()->typeName()))
+        {
+            bytes += QFileInfo(it.key()).size();
+        }
+    }
+
+    return bytes;
+}
@@ -0,0 +1,21 @@
+#ifndef REACHABILITY_H
+#define REACHABILITY_H
+
+#include "../general/schema.h"
+
+class Reachability
+{
+public:
+    Reachability(const SharedPtr<Schema>&, const QMap<QString, SharedPtr<Schema>>&);
+    ~Reachability();
+
+    const QMap<QString, SharedPtr<Schema>>& reachable() const;
+    const QStringList& unreachable() const;
+    qint64 skippedBytes(const QMap<QString, SharedPtr<Schema>>&) const;
+
+private:
+    QMap<QString, SharedPtr<Schema>> _reachable;
+    QStringList _unreachable;
+};
+
+#endif // REACHABILITY_H
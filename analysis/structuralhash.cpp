@@ -0,0 +1,360 @@
+#include "structuralhash.h"
+
+#include <algorithm>
+#include <array>
+
+static int distinct(QVector<quint64> labels)
+{
+    std::sort(labels.begin(), labels.end());
+    return int(std::unique(labels.begin(), labels.end()) - labels.begin());
+}
+
+static QVector<int> ranks(const QVector<quint64>& labels)
+{
+    QVector<int> order(labels.size()), rank(labels.size());
+
+    for(int i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&](int a, int b)
+    {
+        return labels[a] != labels[b] ? labels[a] < labels[b] : a < b;
+    });
+
+    for(int i = 0; i < order.size(); i++)
+    {
+        rank[order[i]] = i;
+    }
+
+    return rank;
+}
+
+StructuralHash::StructuralHash(const QMap<QString, SharedPtr<Schema>>& schemas):
+    _schemas(schemas)
+{
+    for(const QString& type_name : schemas.keys())
+    {
+        compute(type_name);
+    }
+}
+
+StructuralHash::~StructuralHash()
+{
+}
+
+quint64 StructuralHash::mix(quint64 seed, quint64 value)
+{
+    value += 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return seed ^ value ^ (value >> 31);
+}
+
+quint64 StructuralHash::hashString(const QString& string)
+{
+    quint64 hash = 0xcbf29ce484222325ULL;
+
+    for(char c : string.toUtf8())
+    {
+        hash = (hash ^ quint8(c)) * 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+quint64 StructuralHash::hash(const QString& type_name) const
+{
+    return _canonical.value(type_name).hash;
+}
+
+// The hash of a schema together with the schemas of all of its blocks, so a
+// change anywhere below a schema changes it.
+quint64 StructuralHash::hierarchyHash(const QString& type_name) const
+{
+    QMap<QString, quint64> cache;
+    return hierarchyHash(type_name, cache);
+}
+
+quint64 StructuralHash::hierarchyHash(const QString& type_name, QMap<QString, quint64>& cache) const
+{
+    if (cache.contains(type_name) || !_schemas.contains(type_name))
+    {
+        return cache.value(type_name);
+    }
+
+    quint64 result = hash(type_name);
+
+    for(const SharedPtr<Block>& block : _schemas.value(type_name)->blocks())
+    {
+        if (block->type() == BlockType::CUSTOM)
+        {
+            result = mix(result, hierarchyHash(block->typeName(), cache));
+        }
+    }
+
+    cache.insert(type_name, result);
+    return result;
+}
+
+QString StructuralHash::representative(const QString& type_name) const
+{
+    return _representatives.value(type_name, type_name);
+}
+
+const QMap<QString, QString>& StructuralHash::representatives() const
+{
+    return _representatives;
+}
+
+int StructuralHash::duplicates() const
+{
+    int count = 0;
+
+    for(auto it = _representatives.constBegin(); it != _representatives.constEnd(); ++it)
+    {
+        count += it.key() != it.value() ? 1 : 0;
+    }
+
+    return count;
+}
+
+void StructuralHash::compute(const QString& type_name)
+{
+    if (_representatives.contains(type_name) || !_schemas.contains(type_name))
+    {
+        return;
+    }
+
+    SharedPtr<Schema> schema = _schemas.value(type_name);
+
+    for(const SharedPtr<Block>& block : schema->blocks())
+    {
+        if (block->type() == BlockType::CUSTOM)
+        {
+            compute(block->typeName());
+        }
+    }
+
+    Canonical canonical = canonicalize(schema);
+    QString representative = type_name;
+
+    if (!schema->isInterface())
+    {
+        for(const QString& candidate : _groups.value(canonical.hash))
+        {
+            if (equal(_canonical[candidate], canonical))
+            {
+                representative = candidate;
+                break;
+            }
+        }
+
+        if (representative == type_name)
+        {
+            _groups[canonical.hash].append(type_name);
+        }
+    }
+
+    _canonical.insert(type_name, canonical);
+    _representatives.insert(type_name, representative);
+}
+
+StructuralHash::Canonical StructuralHash::canonicalize(const SharedPtr<Schema>& schema) const
+{
+    Canonical canonical;
+    QList<ID> ids = schema->blocks().keys();
+    QHash<ID, int> index;
+
+    for(int i = 0; i < ids.size(); i++)
+    {
+        SharedPtr<Block> block = schema->blocks().value(ids[i]);
+        QString kind = block->type() == BlockType::CUSTOM
+                ? "custom:" + representative(block->typeName())
+                : block->typeName() + "/" + QString::number(block->inputs().size()) + "/" + QString::number(block->outputs().size())
+                  + "/" + QString::number(block->outputWidth(0));
+
+        index.insert(ids[i], i);
+        canonical.kinds.append(hashString(kind));
+    }
+
+    // Edges join single bits, so a bus connection counts as one edge per
+    // bit and a slice is distinguished from the whole port. Blocks in the
+    // graph are numbered in ID order, as in `ids`.
+    const NetGraph& graph = schema->graph();
+
+    for(int pin = 0; pin < graph.inputPinCount(); pin++)
+    {
+        for(int i = 0; i < graph.faninCount(pin); i++)
+        {
+            int driver = graph.fanin(pin)[i];
+
+            canonical.edges.append(Edge {
+                { graph.outputBlock(driver), graph.outputIndex(driver) },
+                { graph.inputBlock(pin), graph.inputIndex(pin) }
+            });
+        }
+    }
+
+    for(const QPair<ID, QString>& input : schema->inputs())
+    {
+        if (index.contains(input.first))
+        {
+            canonical.inputs.append(Port { index[input.first], schema->blocks().value(input.first)->inputs().indexOf(input.second) });
+        }
+    }
+
+    for(const QPair<ID, QString>& output : schema->outputs())
+    {
+        if (index.contains(output.first))
+        {
+            canonical.outputs.append(Port { index[output.first], schema->blocks().value(output.first)->outputs().indexOf(output.second) });
+        }
+    }
+
+    int blocks = canonical.kinds.size();
+    QVector<quint64> labels = canonical.kinds;
+    int classes = distinct(labels);
+
+    for(int round = 0; round < 8 && classes < blocks; round++)
+    {
+        QVector<QVector<quint64>> signatures(blocks);
+
+        for(const Edge& edge : canonical.edges)
+        {
+            signatures[edge.from.block].append(mix(mix(mix(1, edge.from.port), edge.to.port), labels[edge.to.block]));
+            signatures[edge.to.block].append(mix(mix(mix(2, edge.to.port), edge.from.port), labels[edge.from.block]));
+        }
+
+        for(int i = 0; i < canonical.inputs.size(); i++)
+        {
+            signatures[canonical.inputs[i].block].append(mix(mix(3, i), canonical.inputs[i].port));
+        }
+
+        for(int i = 0; i < canonical.outputs.size(); i++)
+        {
+            signatures[canonical.outputs[i].block].append(mix(mix(4, i), canonical.outputs[i].port));
+        }
+
+        QVector<quint64> next = labels;
+
+        for(int i = 0; i < blocks; i++)
+        {
+            std::sort(signatures[i].begin(), signatures[i].end());
+
+            for(quint64 signature : signatures[i])
+            {
+                next[i] = mix(next[i], signature);
+            }
+        }
+
+        int next_classes = distinct(next);
+        labels = next;
+
+        if (next_classes == classes)
+        {
+            break;
+        }
+
+        classes = next_classes;
+    }
+
+    QVector<quint64> sorted_labels = labels, edges;
+    std::sort(sorted_labels.begin(), sorted_labels.end());
+
+    for(const Edge& edge : canonical.edges)
+    {
+        edges.append(mix(mix(mix(labels[edge.from.block], edge.from.port), labels[edge.to.block]), edge.to.port));
+    }
+
+    std::sort(edges.begin(), edges.end());
+
+    quint64 hash = mix(mix(mix(0, blocks), canonical.inputs.size()), canonical.outputs.size());
+
+    for(quint64 label : sorted_labels)
+    {
+        hash = mix(hash, label);
+    }
+
+    for(quint64 edge : edges)
+    {
+        hash = mix(hash, edge);
+    }
+
+    for(const Port& port : canonical.inputs)
+    {
+        hash = mix(hash, mix(labels[port.block], port.port));
+    }
+
+    for(const Port& port : canonical.outputs)
+    {
+        hash = mix(hash, mix(labels[port.block], port.port));
+    }
+
+    canonical.labels = labels;
+    canonical.hash = hash;
+    return canonical;
+}
+
+bool StructuralHash::equal(const Canonical& a, const Canonical& b) const
+{
+    if (a.hash != b.hash
+            || a.kinds.size() != b.kinds.size()
+            || a.edges.size() != b.edges.size()
+            || a.inputs.size() != b.inputs.size()
+            || a.outputs.size() != b.outputs.size())
+    {
+        return false;
+    }
+
+    QVector<int> rank_a = ranks(a.labels), rank_b = ranks(b.labels);
+    QVector<quint64> kinds_a(a.kinds.size()), kinds_b(b.kinds.size());
+
+    for(int i = 0; i < a.kinds.size(); i++)
+    {
+        kinds_a[rank_a[i]] = a.kinds[i];
+        kinds_b[rank_b[i]] = b.kinds[i];
+    }
+
+    if (kinds_a != kinds_b)
+    {
+        return false;
+    }
+
+    auto mapped = [](const Canonical& canonical, const QVector<int>& rank)
+    {
+        QVector<std::array<int, 4>> edges;
+
+        for(const Edge& edge : canonical.edges)
+        {
+            edges.append({ rank[edge.from.block], edge.from.port, rank[edge.to.block], edge.to.port });
+        }
+
+        std::sort(edges.begin(), edges.end());
+        return edges;
+    };
+
+    if (mapped(a, rank_a) != mapped(b, rank_b))
+    {
+        return false;
+    }
+
+    for(int i = 0; i < a.inputs.size(); i++)
+    {
+        if (rank_a[a.inputs[i].block] != rank_b[b.inputs[i].block] || a.inputs[i].port != b.inputs[i].port)
+        {
+            return false;
+        }
+    }
+
+    for(int i = 0; i < a.outputs.size(); i++)
+    {
+        if (rank_a[a.outputs[i].block] != rank_b[b.outputs[i].block] || a.outputs[i].port != b.outputs[i].port)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
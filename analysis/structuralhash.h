@@ -0,0 +1,59 @@
+#ifndef STRUCTURALHASH_H
+#define STRUCTURALHASH_H
+
+#include "../general/schema.h"
+
+#include <QVector>
+
+class StructuralHash
+{
+private:
+    struct Port
+    {
+        int block;
+        int port;
+    };
+
+    struct Edge
+    {
+        Port from;
+        Port to;
+    };
+
+    struct Canonical
+    {
+        QVector<quint64> kinds;
+        QVector<quint64> labels;
+        QVector<Edge> edges;
+        QVector<Port> inputs;
+        QVector<Port> outputs;
+        quint64 hash;
+    };
+
+public:
+    StructuralHash(const QMap<QString, SharedPtr<Schema>>&);
+    ~StructuralHash();
+
+    static quint64 mix(quint64, quint64);
+    static quint64 hashString(const QString&);
+
+    quint64 hash(const QString&) const;
+    quint64 hierarchyHash(const QString&) const;
+    QString representative(const QString&) const;
+    const QMap<QString, QString>& representatives() const;
+    int duplicates() const;
+
+private:
+    void compute(const QString&);
+    quint64 hierarchyHash(const QString&, QMap<QString, quint64>&) const;
+    Canonical canonicalize(const SharedPtr<Schema>&) const;
+    bool equal(const Canonical&, const Canonical&) const;
+
+private:
+    QMap<QString, SharedPtr<Schema>> _schemas;
+    QMap<QString, Canonical> _canonical;
+    QMap<QString, QString> _representatives;
+    QMap<quint64, QStringList> _groups;
+};
+
+#endif // STRUCTURALHASH_H
@@ -0,0 +1,217 @@
+#include "batchcompiler.h"
+
+#include "../analysis/reachability.h"
+#include "../analysis/structuralhash.h"
+#include "../profiler/profiler.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThreadPool>
+
+#include <iostream>
+
+BatchCompiler::BatchCompiler(const QString& output, int jobs, bool lazy, const GeneratorOptions& options):
+    _output(output),
+    _jobs(qMax(1, jobs)),
+    _options(options),
+    _lazy(lazy),
+    _library_time(0),
+    _wall_time(0)
+{
+}
+
+BatchCompiler::~BatchCompiler()
+{
+}
+
+QStringList BatchCompiler::readManifest(const QString& path, bool* ok)
+{
+    QFile file(path);
+    QStringList inputs;
+
+    *ok = file.open(QIODevice::ReadOnly);
+
+    if (*ok)
+    {
+        QDir directory = QFileInfo(path).absoluteDir();
+        QTextStream stream(&file);
+
+        while (!stream.atEnd())
+        {
+            QString line = stream.readLine().trimmed();
+
+            if (!line.isEmpty() && !line.startsWith('#'))
+            {
+                inputs.append(QFileInfo(directory, line).absoluteFilePath());
+            }
+        }
+    }
+
+    return inputs;
+}
+
+bool BatchCompiler::compile(const QStringList& inputs)
+{
+    QElapsedTimer wall;
+    wall.start();
+
+    QSet<QString> used;
+    _results.clear();
+
+    for(const QString& input : inputs)
+    {
+        BatchResult result;
+        result.input = QFileInfo(input).absoluteFilePath();
+        result.output = outputDirectory(input, used);
+        _results.append(result);
+    }
+
+    SharedPtr<const SchemaLibrary> library;
+
+    {
+        ScopedTimer timer("libraries");
+        Parser parser;
+        parser.setLazy(_lazy);
+
+        for(const BatchResult& result : _results)
+        {
+            parser.parseDependencies(result.input);
+        }
+
+        library = std::make_shared<const SchemaLibrary>(parser);
+    }
+
+    _library_time = wall.nsecsElapsed();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(_jobs);
+
+    for(int i = 0; i < _results.size(); i++)
+    {
+        BatchResult* result = &_results[i];
+
+        pool.start([this, result, library]()
+        {
+            ScopedTimer timer("design", QFileInfo(result->input).fileName());
+            QElapsedTimer elapsed;
+            Parser parser;
+            parser.setLazy(_lazy);
+            parser.setLibrary(library);
+            parser.setDiagnosticHandler([result](const Diagnostic& diagnostic)
+            {
+                result->diagnostics.append(diagnostic.message);
+            });
+
+            elapsed.start();
+            result->success = parser.parse(result->input) && parser.mainSchema();
+            result->parse_time = elapsed.nsecsElapsed();
+
+            if (result->success)
+            {
+                elapsed.start();
+                Reachability reachability(parser.mainSchema(), parser.schemas());
+                Generator generator;
+                generator.setOptions(_options);
+
+                if (_options.dedup)
+                {
+                    StructuralHash hash(reachability.reachable());
+                    generator.setRepresentatives(hash.representatives());
+                    result->merged = hash.duplicates();
+                }
+
+                QDir().mkpath(result->output);
+                generator.generate(result->output, parser.mainSchema(), reachability.reachable());
+                QStringList errors = generator.takeWriteErrors();
+                result->diagnostics.append(errors);
+                result->diagnostics.append(generator.memoizeWarnings());
+                result->success = errors.isEmpty();
+                result->generate_time = elapsed.nsecsElapsed();
+                result->schemas = reachability.reachable().size();
+                result->skipped = reachability.unreachable().size();
+                result->saved_lines = generator.savedLines();
+            }
+        });
+    }
+
+    pool.waitForDone();
+    _wall_time = wall.nsecsElapsed();
+
+    for(const BatchResult& result : _results)
+    {
+        for(const QString& diagnostic : result.diagnostics)
+        {
+            std::cerr << diagnostic.toStdString() << std::endl;
+        }
+    }
+
+    for(const BatchResult& result : _results)
+    {
+        if (!result.success)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void BatchCompiler::printSummary(std::ostream& out) const
+{
+    int failures = 0;
+    int saved_lines = 0;
+
+    out << QString("%1  %2 %3 %4 %5 %6 %7")
+           .arg("design", -40)
+           .arg("status", -7)
+           .arg("schemas", 8)
+           .arg("skipped", 8)
+           .arg("merged", 8)
+           .arg("parse ms", 10)
+           .arg("gen ms", 10).toStdString() << std::endl;
+
+    for(const BatchResult& result : _results)
+    {
+        failures += result.success ? 0 : 1;
+        saved_lines += result.saved_lines;
+
+        out << QString("%1  %2 %3 %4 %5 %6 %7")
+               .arg(QFileInfo(result.input).fileName(), -40)
+               .arg(result.success ? "ok" : "FAILED", -7)
+               .arg(result.schemas, 8)
+               .arg(result.skipped, 8)
+               .arg(result.merged, 8)
+               .arg(result.parse_time / 1e6, 10, 'f', 2)
+               .arg(result.generate_time / 1e6, 10, 'f', 2).toStdString() << std::endl;
+    }
+
+    out << QString("%1 design(s), %2 failed, shared libraries %3 ms, wall time %4 ms, %5 job(s), %6 line(s) saved by dedup")
+           .arg(_results.size())
+           .arg(failures)
+           .arg(_library_time / 1e6, 0, 'f', 2)
+           .arg(_wall_time / 1e6, 0, 'f', 2)
+           .arg(_jobs)
+           .arg(saved_lines).toStdString() << std::endl;
+}
+
+const QList<BatchResult>& BatchCompiler::results() const
+{
+    return _results;
+}
+
+QString BatchCompiler::outputDirectory(const QString& input, QSet<QString>& used) const
+{
+    QString name = QFileInfo(input).completeBaseName();
+    QString candidate = name;
+
+    for(int i = 2; used.contains(candidate); i++)
+    {
+        candidate = name + "_" + QString::number(i);
+    }
+
+    used.insert(candidate);
+    return _output + "/" + candidate;
+}
@@ -0,0 +1,49 @@
+#ifndef BATCHCOMPILER_H
+#define BATCHCOMPILER_H
+
+#include "../parser/parser.h"
+#include "../generator/generator.h"
+
+#include <ostream>
+
+struct BatchResult
+{
+    QString input;
+    QString output;
+    bool success = false;
+    int schemas = 0;
+    int skipped = 0;
+    int merged = 0;
+    int saved_lines = 0;
+    qint64 parse_time = 0;
+    qint64 generate_time = 0;
+    QStringList diagnostics;
+};
+
+class BatchCompiler
+{
+public:
+    BatchCompiler(const QString& output, int jobs, bool lazy, const GeneratorOptions& options);
+    ~BatchCompiler();
+
+    static QStringList readManifest(const QString&, bool*);
+
+    bool compile(const QStringList&);
+    void printSummary(std::ostream&) const;
+
+    const QList<BatchResult>& results() const;
+
+private:
+    QString outputDirectory(const QString&, QSet<QString>&) const;
+
+private:
+    QString _output;
+    int _jobs;
+    GeneratorOptions _options;
+    bool _lazy;
+    qint64 _library_time;
+    qint64 _wall_time;
+    QList<BatchResult> _results;
+};
+
+#endif // BATCHCOMPILER_H
@@ -0,0 +1,19 @@
+QT -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = lsc-bench
+
+include(../compiler.pri)
+
+SOURCES += \
+    main.cpp \
+    perfcounter.cpp \
+    stress.cpp \
+    synthetic.cpp
+
+HEADERS += \
+    perfcounter.h \
+    stress.h \
+    synthetic.h
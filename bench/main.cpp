@@ -0,0 +1,506 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+
+#include "../parser/parser.h"
+#include "../generator/generator.h"
+#include "../generator/runtime/simulation.hpp"
+#include "../mapping/lutmapper.h"
+#include "../netlist/netlist.h"
+#include "../profiler/profiler.h"
+#include "perfcounter.h"
+#include "stress.h"
+#include "synthetic.h"
+
+struct BenchmarkCase
+{
+    QString name;
+    QString path;
+    std::function<bool(const Parser&)> check;
+};
+
+static QJsonObject summary(QList<qint64> nsecs)
+{
+    std::sort(nsecs.begin(), nsecs.end());
+
+    double total = 0;
+
+    for(qint64 value : nsecs)
+    {
+        total += value;
+    }
+
+    return QJsonObject {
+        { "min_ms", nsecs.first() / 1e6 },
+        { "median_ms", nsecs[nsecs.size() / 2] / 1e6 },
+        { "mean_ms", total / nsecs.size() / 1e6 },
+        { "max_ms", nsecs.last() / 1e6 }
+    };
+}
+
+static qint64 inputBytes(const QString& path)
+{
+    QFileInfo info(path);
+    qint64 bytes = 0;
+
+    for(const QString& entry : info.absoluteDir().entryList({ "*.json" }, QDir::Files))
+    {
+        bytes += QFileInfo(info.absoluteDir(), entry).size();
+    }
+
+    return bytes;
+}
+
+// The arrays of a netlist in the form the generated netlist.hpp declares.
+struct CompiledNetlist
+{
+    std::vector<uint8_t> kinds;
+    std::vector<uint32_t> offsets, fanin, output_nets;
+    std::vector<uint32_t> lut_offsets, lut_leaves, lut_nets;
+    std::vector<uint64_t> lut_tables;
+    lsc::Netlist netlist;
+
+    CompiledNetlist(const Netlist& source, const LutMapper* mapper):
+        offsets(1, 0),
+        lut_offsets(1, 0)
+    {
+        for(int gate = 0; gate < source.gateCount(); gate++)
+        {
+            kinds.push_back(uint8_t(source.kind(gate)));
+            fanin.insert(fanin.end(), source.fanin(gate), source.fanin(gate) + source.faninCount(gate));
+            offsets.push_back(uint32_t(fanin.size()));
+        }
+
+        for(int output = 0; output < source.outputCount(); output++)
+        {
+            output_nets.push_back(uint32_t(source.outputNet(output)));
+        }
+
+        for(const Lut& lut : mapper ? mapper->luts() : QVector<Lut>())
+        {
+            lut_leaves.insert(lut_leaves.end(), lut.leaves.begin(), lut.leaves.end());
+            lut_offsets.push_back(uint32_t(lut_leaves.size()));
+            lut_nets.push_back(uint32_t(lut.net));
+            lut_tables.push_back(lut.table);
+        }
+
+        netlist = { uint32_t(source.inputCount()), uint32_t(source.outputCount()), uint32_t(source.gateCount()),
+                    kinds.data(), offsets.data(), fanin.data(), output_nets.data(),
+                    nullptr, nullptr, 0, nullptr, nullptr, nullptr, nullptr, 0,
+                    uint32_t(lut_nets.size()), uint32_t(mapper ? mapper->scratchNets() : 0),
+                    lut_offsets.data(), lut_leaves.data(), lut_nets.data(), lut_tables.data() };
+    }
+};
+
+// Runs random passes and returns the nanoseconds they took.
+static qint64 measure(lsc::Simulator& simulator, int passes, PerfCounter* counter)
+{
+    QRandomGenerator random(1);
+
+    for(uint32_t input = 0; input < simulator.netlist().inputs; input++)
+    {
+        for(uint32_t lane = 0; lane < lsc::Simulator::lanes; lane++)
+        {
+            simulator.input(input)[lane] = random.generate64();
+        }
+    }
+
+    simulator.run(lsc::Simulator::vectors);
+
+    QElapsedTimer timer;
+
+    if (counter)
+    {
+        counter->start();
+    }
+
+    timer.start();
+
+    for(int pass = 0; pass < passes; pass++)
+    {
+        simulator.run(lsc::Simulator::vectors);
+    }
+
+    qint64 elapsed = qMax<qint64>(1, timer.nsecsElapsed());
+
+    if (counter)
+    {
+        counter->stop();
+    }
+
+    return elapsed;
+}
+
+// Multiplies with the generated array multiplier and compares every product
+// bit with a schoolbook product. The first vector multiplies all ones, which
+// drives every carry; the others are random.
+static bool multiplies(const Parser& parser, int bits)
+{
+    Netlist netlist(parser.mainSchema(), parser.schemas());
+
+    if (!netlist.isValid())
+    {
+        return false;
+    }
+
+    CompiledNetlist compiled(netlist, nullptr);
+    lsc::Simulator simulator(compiled.netlist);
+    QRandomGenerator random(1);
+    QHash<QString, int> inputs, outputs;
+    QVector<QVector<int>> products;
+
+    for(int input = 0; input < netlist.inputCount(); input++)
+    {
+        inputs.insert(netlist.inputName(input), input);
+    }
+
+    for(int output = 0; output < netlist.outputCount(); output++)
+    {
+        outputs.insert(netlist.outputName(output), output);
+    }
+
+    for(uint32_t vector = 0; vector < lsc::Simulator::vectors; vector++)
+    {
+        QVector<int> a(bits), b(bits), product(2 * bits, 0);
+
+        for(int i = 0; i < bits; i++)
+        {
+            a[i] = vector == 0 || random.bounded(2);
+            b[i] = vector == 0 || random.bounded(2);
+
+            if (a[i])
+            {
+                simulator.setInput(uint32_t(inputs.value("a" + QString::number(i))), vector);
+            }
+
+            if (b[i])
+            {
+                simulator.setInput(uint32_t(inputs.value("b" + QString::number(i))), vector);
+            }
+        }
+
+        for(int i = 0; i < bits; i++)
+        {
+            for(int j = 0; j < bits; j++)
+            {
+                product[i + j] += a[i] & b[j];
+            }
+        }
+
+        for(int k = 0; k + 1 < product.size(); k++)
+        {
+            product[k + 1] += product[k] / 2;
+            product[k] %= 2;
+        }
+
+        products.append(product);
+    }
+
+    simulator.run(lsc::Simulator::vectors);
+
+    for(uint32_t vector = 0; vector < lsc::Simulator::vectors; vector++)
+    {
+        for(int k = 0; k < 2 * bits; k++)
+        {
+            QString name = "p" + QString::number(k);
+            int bit = outputs.contains(name) ? simulator.outputBit(uint32_t(outputs.value(name)), vector) : 0;
+
+            if (bit != products[int(vector)][k])
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Evaluates the flattened design with the batch simulator's evaluator in
+// every gate layout and reports throughput and, where perf counters are
+// available, cache misses. The design is also mapped to 6-input LUTs; a
+// design with registers is then run cycle by cycle with table lookups and
+// with gates, and the outputs of both runs are compared.
+static QJsonObject evaluation(const Parser& parser, int passes)
+{
+    Netlist base(parser.mainSchema(), parser.schemas());
+    QJsonObject result;
+
+    if (!base.isValid())
+    {
+        result.insert("error", base.error());
+        return result;
+    }
+
+    // Each vector of a design with registers is one clock cycle.
+    result.insert("registers", base.registerCount());
+
+    for(const char* name : { "topological", "level", "dfs" })
+    {
+        bool ok;
+        Netlist netlist = base;
+        netlist.relayout(Netlist::layoutOf(name, &ok));
+
+        CompiledNetlist compiled(netlist, nullptr);
+        lsc::Simulator simulator(compiled.netlist);
+        PerfCounter counter;
+        qint64 elapsed = measure(simulator, passes, &counter);
+
+        QJsonObject layout {
+            { "ns_per_pass", double(elapsed) / passes },
+            { "vectors_per_s", double(passes) * lsc::Simulator::vectors * 1e9 / elapsed }
+        };
+
+        if (counter.isAvailable())
+        {
+            layout.insert("cache_misses", double(counter.cacheMisses()));
+            layout.insert("cache_references", double(counter.cacheReferences()));
+        }
+
+        result.insert(name, layout);
+    }
+
+    Netlist netlist = base;
+    netlist.relayout(NetLayout::DFS);
+
+    QElapsedTimer timer;
+    timer.start();
+    LutMapper mapper(netlist, 6);
+    qint64 mapping = timer.nsecsElapsed();
+
+    QJsonObject lut {
+        { "gates", mapper.gateCount() },
+        { "luts", mapper.luts().size() },
+        { "reduction_percent", mapper.reduction() },
+        { "depth", mapper.depth() },
+        { "map_ms", mapping / 1e6 }
+    };
+
+    if (base.registerCount() > 0)
+    {
+        CompiledNetlist compiled(netlist, &mapper);
+        lsc::Simulator gates(compiled.netlist), tables(compiled.netlist);
+        tables.setLookup(true);
+
+        qint64 gate_elapsed = measure(gates, passes, nullptr);
+        qint64 lut_elapsed = measure(tables, passes, nullptr);
+        bool same = true;
+
+        for(uint32_t output = 0; output < compiled.netlist.outputs; output++)
+        {
+            same = same && std::equal(gates.output(output), gates.output(output) + lsc::Simulator::lanes, tables.output(output));
+        }
+
+        lut.insert("gate_cycles_per_s", double(passes) * lsc::Simulator::vectors * 1e9 / gate_elapsed);
+        lut.insert("lut_cycles_per_s", double(passes) * lsc::Simulator::vectors * 1e9 / lut_elapsed);
+        lut.insert("speedup", double(gate_elapsed) / lut_elapsed);
+        lut.insert("outputs_match", same);
+    }
+
+    result.insert("lut", lut);
+    return result;
+}
+
+static QJsonObject run(const BenchmarkCase& benchmark, int iterations, int passes)
+{
+    QList<qint64> parse, validate, generate;
+    QJsonObject result { { "name", benchmark.name } };
+
+    for(int i = 0; i < iterations; i++)
+    {
+        Parser parser;
+        QElapsedTimer timer;
+        Profiler::instance().reset();
+
+        // parse() validates each schema as it goes, so validation is taken
+        // out of the parse time to keep the columns apart.
+        timer.start();
+        bool parsed = parser.parse(benchmark.path);
+        qint64 elapsed = timer.nsecsElapsed();
+        validate.append(Profiler::instance().elapsed("validate"));
+        parse.append(elapsed - validate.last());
+
+        if (!parsed)
+        {
+            result.insert("error", "parse failed");
+            return result;
+        }
+
+        QTemporaryDir output;
+        Generator generator;
+
+        timer.start();
+        generator.generate(output.path(), parser.mainSchema(), parser.schemas());
+        generate.append(timer.nsecsElapsed());
+
+        if (i == 0)
+        {
+            int blocks = 0, connections = 0;
+
+            for(const SharedPtr<Schema>& schema : parser.schemas())
+            {
+                blocks += schema->blocks().size();
+                connections += schema->connections().size();
+            }
+
+            result.insert("schemas", parser.schemas().size());
+            result.insert("blocks", blocks);
+            result.insert("connections", connections);
+
+            if (passes > 0)
+            {
+                result.insert("evaluation", evaluation(parser, passes));
+            }
+
+            if (benchmark.check)
+            {
+                result.insert("correct", benchmark.check(parser));
+            }
+        }
+    }
+
+    result.insert("parse", summary(parse));
+    result.insert("validate", summary(validate));
+    result.insert("generate", summary(generate));
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser cli;
+
+    cli.setApplicationDescription("Logic schemes compiler benchmark");
+    cli.addHelpOption();
+    cli.addOptions({
+        { "iterations", "Runs per benchmark.", "n", "5" },
+        { "passes", "Evaluation passes per gate layout, 0 to skip.", "n", "200" },
+        { "scale", "Multiplier for the design sizes.", "n", "1" },
+        { "emit", "Write the synthetic designs to <dir> and exit.", "dir" },
+        { "stress", "Check that parse time and memory grow linearly, exit 1 if not." },
+        { "sample", "Measure a single --stress sample, <kind>:<file>, and print it as JSON.", "sample" },
+        { "fuzz", "Parse <n> corrupted designs, exit 1 if one takes too long.", "n" },
+        { "seed", "Seed for --fuzz.", "n", "1" },
+        { "output", "Write the JSON report to <file> instead of stdout.", "file" }
+    });
+    cli.process(app);
+
+    if (cli.isSet("sample"))
+    {
+        QString sample = cli.value("sample");
+        QJsonObject result = stressSample(sample.section(':', 0, 0), sample.section(':', 1));
+        std::cout << QJsonDocument(result).toJson(QJsonDocument::Compact).toStdString() << std::endl;
+        return 0;
+    }
+
+    int iterations = qMax(1, cli.value("iterations").toInt());
+    Profiler::instance().setEnabled(true);
+    int scale = qMax(1, cli.value("scale").toInt());
+
+    QTemporaryDir temporary;
+    QString directory = cli.isSet("emit") ? cli.value("emit") : temporary.path();
+    QDir().mkpath(directory);
+
+    if (cli.isSet("stress") || cli.isSet("fuzz"))
+    {
+        bool passed = true;
+        QJsonObject report;
+
+        if (cli.isSet("stress"))
+        {
+            report = stressTest(directory, scale, &passed);
+        }
+
+        if (cli.isSet("fuzz"))
+        {
+            bool fuzzed;
+            QJsonObject fuzz = fuzzTest(directory, qMax(1, cli.value("fuzz").toInt()), cli.value("seed").toUInt(), &fuzzed);
+            report.insert("fuzz", fuzz.value("fuzz"));
+            report.insert("passed", passed && fuzzed);
+            passed = passed && fuzzed;
+        }
+
+        std::cout << QJsonDocument(report).toJson().toStdString();
+        return passed ? 0 : 1;
+    }
+
+    QList<BenchmarkCase> benchmarks;
+
+    auto add = [&](const QString& name, const std::function<QString(SyntheticGenerator&)>& build,
+                   const std::function<bool(const Parser&)>& check = nullptr)
+    {
+        QString case_directory = directory + "/" + name;
+        QDir().mkpath(case_directory);
+        SyntheticGenerator synthetic(case_directory);
+        benchmarks.append(BenchmarkCase { name, build(synthetic), check });
+    };
+
+    add("ripple_adder", [=](SyntheticGenerator& s) { return s.rippleCarryAdder(256 * scale); });
+    add("lookahead_adder", [=](SyntheticGenerator& s) { return s.carryLookaheadAdder(256 * scale); });
+    add("array_multiplier", [=](SyntheticGenerator& s) { return s.arrayMultiplier(32 * scale); },
+        [=](const Parser& p) { return multiplies(p, 32 * scale); });
+    add("random_dag", [=](SyntheticGenerator& s) { return s.randomDag(20000 * scale, 50000 * scale, 1); });
+    add("deep_hierarchy", [=](SyntheticGenerator& s) { return s.deepHierarchy(256 * scale); });
+    add("bit_datapath", [=](SyntheticGenerator& s) { return s.datapath(64, 64 * scale, false); });
+    add("bus_datapath", [=](SyntheticGenerator& s) { return s.datapath(64, 64 * scale, true); });
+    add("parameterised_adder", [=](SyntheticGenerator& s) { return s.parameterisedAdder(256 * scale); });
+    add("accumulator", [=](SyntheticGenerator& s) { return s.accumulator(256 * scale); });
+
+    if (cli.isSet("emit"))
+    {
+        for(const BenchmarkCase& benchmark : benchmarks)
+        {
+            std::cout << benchmark.path.toStdString() << std::endl;
+        }
+
+        return 0;
+    }
+
+    QJsonArray results;
+    bool correct = true;
+
+    for(const BenchmarkCase& benchmark : benchmarks)
+    {
+        QJsonObject result = run(benchmark, iterations, cli.value("passes").toInt());
+        result.insert("input_bytes", double(inputBytes(benchmark.path)));
+        correct = correct && result.value("correct").toBool(true);
+        results.append(result);
+    }
+
+    QByteArray report = QJsonDocument(QJsonObject {
+        { "iterations", iterations },
+        { "scale", scale },
+        { "benchmarks", results }
+    }).toJson();
+
+    if (cli.isSet("output"))
+    {
+        QFile file(cli.value("output"));
+
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            std::cerr << "Cannot write \"" << cli.value("output").toStdString() << "\"" << std::endl;
+            return 1;
+        }
+
+        file.write(report);
+        file.close();
+    }
+    else
+    {
+        std::cout << report.toStdString();
+    }
+
+    return correct ? 0 : 1;
+}
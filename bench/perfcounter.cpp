@@ -0,0 +1,95 @@
+#include "perfcounter.h"
+
+#ifdef Q_OS_LINUX
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+
+static int openCounter(quint64 config)
+{
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.size = sizeof(attributes);
+    attributes.config = config;
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+
+    return int(syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+
+static qint64 readCounter(int fd)
+{
+    qint64 value = 0;
+    return fd >= 0 && read(fd, &value, sizeof(value)) == sizeof(value) ? value : -1;
+}
+#endif
+
+PerfCounter::PerfCounter():
+    _misses(-1),
+    _references(-1),
+    _miss_count(-1),
+    _reference_count(-1)
+{
+#ifdef Q_OS_LINUX
+    _misses = openCounter(PERF_COUNT_HW_CACHE_MISSES);
+    _references = openCounter(PERF_COUNT_HW_CACHE_REFERENCES);
+#endif
+}
+
+PerfCounter::~PerfCounter()
+{
+#ifdef Q_OS_LINUX
+    if (_misses >= 0) close(_misses);
+    if (_references >= 0) close(_references);
+#endif
+}
+
+bool PerfCounter::isAvailable() const
+{
+    return _misses >= 0 && _references >= 0;
+}
+
+void PerfCounter::start()
+{
+#ifdef Q_OS_LINUX
+    for(int fd : { _misses, _references })
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+void PerfCounter::stop()
+{
+#ifdef Q_OS_LINUX
+    for(int fd : { _misses, _references })
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    _miss_count = readCounter(_misses);
+    _reference_count = readCounter(_references);
+#endif
+}
+
+qint64 PerfCounter::cacheMisses() const
+{
+    return _miss_count;
+}
+
+qint64 PerfCounter::cacheReferences() const
+{
+    return _reference_count;
+}
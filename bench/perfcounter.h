@@ -0,0 +1,31 @@
+#ifndef PERFCOUNTER_H
+#define PERFCOUNTER_H
+
+#include <QtGlobal>
+
+// Hardware cache counters of the calling thread through perf_event_open.
+// Elsewhere, or when the kernel refuses access, isAvailable() is false.
+class PerfCounter
+{
+public:
+    PerfCounter();
+    ~PerfCounter();
+
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+
+    bool isAvailable() const;
+    void start();
+    void stop();
+
+    qint64 cacheMisses() const;
+    qint64 cacheReferences() const;
+
+private:
+    int _misses;
+    int _references;
+    qint64 _miss_count;
+    qint64 _reference_count;
+};
+
+#endif // PERFCOUNTER_H
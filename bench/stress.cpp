@@ -0,0 +1,374 @@
+#include "stress.h"
+
+#include "../generator/generator.h"
+#include "../parser/parser.h"
+#include "../profiler/profiler.h"
+#include "synthetic.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QRandomGenerator>
+
+#include <functional>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// Four times the input may take at most eight times as long (a quadratic
+// path would take sixteen), plus a constant for timer and allocator noise.
+static const int time_ratio = 8;
+static const qint64 time_slack = 50000000;
+static const qint64 memory_per_byte = 64;
+static const qint64 memory_slack = 64 * 1048576;
+static const qint64 fuzz_limit = 1000000000;
+
+static const QByteArray fuzz_bytes = "{}[]\",:0123456789-.eEtruefalsnl \n\\";
+
+struct StressSample
+{
+    qint64 nsecs;
+    qint64 memory;
+    qint64 bytes;
+    bool parsed;
+};
+
+// Returns freed heap to the system and restarts the peak RSS from the
+// current RSS, so that the next Profiler::peakMemory() only covers what
+// follows. Where the peak cannot be restarted (clear_refs is Linux only) it
+// stays, which is harmless in the fresh process every sample runs in.
+static qint64 restartPeakMemory()
+{
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+
+    QFile clear_refs("/proc/self/clear_refs");
+
+    if (clear_refs.open(QIODevice::WriteOnly))
+    {
+        clear_refs.write("5");
+        clear_refs.close();
+    }
+
+    return Profiler::peakMemory();
+}
+
+static StressSample parseSample(const QString& path)
+{
+    Parser parser;
+    QElapsedTimer timer;
+    qint64 memory = restartPeakMemory();
+    qint64 bytes = 0;
+
+    parser.setDiagnosticHandler([](const Diagnostic&) {});
+
+    QDir directory = QFileInfo(path).absoluteDir();
+
+    for(const QString& entry : directory.entryList({ "*.json" }, QDir::Files))
+    {
+        bytes += QFileInfo(directory, entry).size();
+    }
+
+    timer.start();
+    bool parsed = parser.parse(path);
+
+    return { timer.nsecsElapsed(), Profiler::peakMemory() - memory, bytes, parsed };
+}
+
+// Generates the header of the design's main schema. The peak is restarted
+// after parsing, so only what the emitter itself holds counts.
+static StressSample emitSample(const QString& path)
+{
+    Parser parser;
+    QElapsedTimer timer;
+
+    parser.setDiagnosticHandler([](const Diagnostic&) {});
+
+    if (!parser.parse(path))
+    {
+        return { 0, 0, 0, false };
+    }
+
+    QString output = QFileInfo(path).absolutePath() + "/out";
+    QDir().mkpath(output);
+    qint64 memory = restartPeakMemory();
+    Generator generator;
+
+    timer.start();
+    generator.generateSchemas(output, { parser.mainSchema() });
+    qint64 nsecs = timer.nsecsElapsed();
+    qint64 bytes = QFileInfo(output + "/" + parser.mainSchema()->typeName() + ".hpp").size();
+
+    return { nsecs, Profiler::peakMemory() - memory, bytes, true };
+}
+
+QJsonObject stressSample(const QString& kind, const QString& path)
+{
+    StressSample sample { 0, 0, 0, false };
+
+    if (kind == "parse")
+    {
+        sample = parseSample(path);
+    }
+    else if (kind == "emit")
+    {
+        sample = emitSample(path);
+    }
+
+    return QJsonObject {
+        { "nsecs", double(sample.nsecs) },
+        { "memory", double(sample.memory) },
+        { "bytes", double(sample.bytes) },
+        { "parsed", sample.parsed }
+    };
+}
+
+// The peak RSS only ever grows within a process, so every sample runs in a
+// new lsc-bench process.
+static StressSample isolatedSample(const QString& kind, const QString& path)
+{
+    QProcess process;
+    process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    process.start(QCoreApplication::applicationFilePath(), { "--sample", kind + ":" + path });
+
+    if (!process.waitForFinished(-1) || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+    {
+        return { 0, 0, 0, false };
+    }
+
+    QJsonObject sample = QJsonDocument::fromJson(process.readAllStandardOutput()).object();
+
+    return {
+        qint64(sample.value("nsecs").toDouble()),
+        qint64(sample.value("memory").toDouble()),
+        qint64(sample.value("bytes").toDouble()),
+        sample.value("parsed").toBool()
+    };
+}
+
+static QJsonObject sampleObject(const StressSample& sample)
+{
+    return QJsonObject {
+        { "parse_ms", sample.nsecs / 1e6 },
+        { "memory_mb", sample.memory / 1048576.0 },
+        { "input_bytes", double(sample.bytes) }
+    };
+}
+
+QJsonObject stressTest(const QString& directory, int scale, bool* passed)
+{
+    QJsonArray results;
+    *passed = true;
+
+    auto check = [&](const QString& name, int size, const std::function<QString(SyntheticGenerator&, int)>& build)
+    {
+        StressSample samples[2];
+        QString errors;
+
+        for(int i = 0; i < 2; i++)
+        {
+            QString case_directory = QString("%1/%2_%3").arg(directory, name).arg(i);
+            QDir().mkpath(case_directory);
+            SyntheticGenerator synthetic(case_directory);
+            samples[i] = isolatedSample("parse", build(synthetic, i == 0 ? size / 4 : size));
+
+            if (!samples[i].parsed)
+            {
+                errors = "parse failed";
+            }
+        }
+
+        if (errors.isEmpty() && samples[1].nsecs > time_ratio * samples[0].nsecs + time_slack)
+        {
+            errors = "parse time grows faster than linearly";
+        }
+        else if (errors.isEmpty() && samples[1].memory > memory_per_byte * samples[1].bytes + memory_slack)
+        {
+            errors = "peak memory is not proportional to the input";
+        }
+
+        QJsonObject result {
+            { "name", name },
+            { "size", size },
+            { "quarter", sampleObject(samples[0]) },
+            { "full", sampleObject(samples[1]) },
+            { "passed", errors.isEmpty() }
+        };
+
+        if (!errors.isEmpty())
+        {
+            result.insert("error", errors);
+            *passed = false;
+        }
+
+        results.append(result);
+    };
+
+    check("wide_ports", 100000 * scale, [](SyntheticGenerator& s, int n) { return s.wideGate(n); });
+    check("deep_using", 10000 * scale, [](SyntheticGenerator& s, int n) { return s.deepHierarchy(n); });
+    check("huge_connections", 400000 * scale, [](SyntheticGenerator& s, int n) { return s.randomDag(n / 2, n, 1); });
+
+    auto emission = [&](const QString& name, int size)
+    {
+        StressSample samples[2];
+        QJsonObject sizes[2];
+        QString errors;
+
+        for(int i = 0; i < 2; i++)
+        {
+            QString case_directory = QString("%1/%2_%3").arg(directory, name).arg(i);
+            QDir().mkpath(case_directory);
+            SyntheticGenerator synthetic(case_directory);
+            int n = i == 0 ? size / 4 : size;
+            samples[i] = isolatedSample("emit", synthetic.randomDag(n / 2, n, 1));
+
+            if (!samples[i].parsed)
+            {
+                errors = "parse failed";
+            }
+
+            sizes[i] = QJsonObject {
+                { "emit_ms", samples[i].nsecs / 1e6 },
+                { "output_mb", samples[i].bytes / 1048576.0 },
+                { "mb_per_s", samples[i].nsecs == 0 ? 0.0 : samples[i].bytes / 1048576.0 / (samples[i].nsecs / 1e9) },
+                { "memory_mb", samples[i].memory / 1048576.0 }
+            };
+        }
+
+        if (errors.isEmpty() && samples[1].nsecs > time_ratio * samples[0].nsecs + time_slack)
+        {
+            errors = "emit time grows faster than linearly";
+        }
+        else if (errors.isEmpty() && samples[1].memory > memory_slack)
+        {
+            errors = "peak memory grows with the output";
+        }
+
+        QJsonObject result {
+            { "name", name },
+            { "size", size },
+            { "quarter", sizes[0] },
+            { "full", sizes[1] },
+            { "passed", errors.isEmpty() }
+        };
+
+        if (!errors.isEmpty())
+        {
+            result.insert("error", errors);
+            *passed = false;
+        }
+
+        results.append(result);
+    };
+
+    emission("emit_huge_schema", 400000 * scale);
+
+    return QJsonObject { { "stress", results }, { "passed", *passed } };
+}
+
+static QByteArray mutate(QByteArray data, QRandomGenerator& random)
+{
+    int mutations = 1 + random.bounded(4);
+
+    for(int i = 0; i < mutations && !data.isEmpty(); i++)
+    {
+        int position = random.bounded(data.size());
+        int length = 1 + random.bounded(qMin(64, data.size() - position));
+
+        switch (random.bounded(4))
+        {
+        case 0:
+            data[position] = fuzz_bytes[random.bounded(fuzz_bytes.size())];
+            break;
+        case 1:
+            data.remove(position, length);
+            break;
+        case 2:
+            data.insert(position, data.mid(position, length));
+            break;
+        default:
+            data.truncate(position);
+            break;
+        }
+    }
+
+    return data;
+}
+
+QJsonObject fuzzTest(const QString& directory, int count, quint32 seed, bool* passed)
+{
+    QRandomGenerator random(seed);
+    QStringList seeds;
+    QJsonArray failures;
+    int rejected = 0;
+    qint64 slowest = 0;
+
+    SyntheticGenerator synthetic(directory);
+    seeds.append(synthetic.rippleCarryAdder(4));
+    seeds.append(synthetic.arrayMultiplier(3));
+    seeds.append(synthetic.randomDag(40, 100, seed));
+
+    QList<QByteArray> originals;
+
+    for(const QString& path : seeds)
+    {
+        QFile file(path);
+        file.open(QIODevice::ReadOnly);
+        originals.append(file.readAll());
+    }
+
+    QString path = directory + "/fuzz.json";
+
+    for(int i = 0; i < count; i++)
+    {
+        QByteArray data = mutate(originals[random.bounded(originals.size())], random);
+        QFile file(path);
+
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            failures.append(QJsonObject { { "error", "cannot write " + path } });
+            break;
+        }
+
+        file.write(data);
+        file.close();
+
+        Parser parser;
+        QElapsedTimer timer;
+        parser.setDiagnosticHandler([](const Diagnostic&) {});
+
+        timer.start();
+        bool parsed = parser.parse(path);
+        qint64 elapsed = timer.nsecsElapsed();
+
+        slowest = qMax(slowest, elapsed);
+        rejected += parsed ? 0 : 1;
+
+        if (elapsed > fuzz_limit)
+        {
+            QString kept = QString("%1/slow%2.json").arg(directory).arg(i);
+            QFile::copy(path, kept);
+            failures.append(QJsonObject { { "input", kept }, { "parse_ms", elapsed / 1e6 } });
+        }
+    }
+
+    *passed = failures.isEmpty();
+
+    return QJsonObject {
+        { "fuzz", QJsonObject {
+            { "inputs", count },
+            { "seed", double(seed) },
+            { "rejected", rejected },
+            { "slowest_ms", slowest / 1e6 },
+            { "failures", failures }
+        } },
+        { "passed", *passed }
+    };
+}
@@ -0,0 +1,21 @@
+#ifndef STRESS_H
+#define STRESS_H
+
+#include <QJsonObject>
+#include <QString>
+
+// Parses designs that are pathological for one dimension (ports per block,
+// `using` depth, connections) at two sizes and fails when parse time or
+// peak memory grows faster than linearly. Also emits the header of a huge
+// schema and fails when the emitter's peak memory is not bounded.
+QJsonObject stressTest(const QString& directory, int scale, bool* passed);
+
+// Measures one sample of stressTest() in this process, which stressTest()
+// starts for it with --sample. `kind` is "parse" or "emit".
+QJsonObject stressSample(const QString& kind, const QString& path);
+
+// Parses randomly corrupted copies of small designs. Every parse must finish
+// within a time bound, with or without diagnostics.
+QJsonObject fuzzTest(const QString& directory, int count, quint32 seed, bool* passed);
+
+#endif // STRESS_H
@@ -0,0 +1,803 @@
+#include "synthetic.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+
+static const QStringList multiphase_types =
+{
+    "And",
+    "AndNot",
+    "Or",
+    "OrNot"
+};
+
+static SyntheticSignal xorGate(SyntheticSchema& schema, const SyntheticSignal& a, const SyntheticSignal& b)
+{
+    SyntheticSignal any = schema.addGate("Or", { a, b });
+    SyntheticSignal not_both = schema.addGate("AndNot", { a, b });
+    return schema.addGate("And", { any, not_both });
+}
+
+SyntheticSchema::SyntheticSchema():
+    _next_id(0)
+{
+}
+
+SyntheticSchema::SyntheticSchema(const QString& type_name):
+    _next_id(0),
+    _type_name(type_name)
+{
+}
+
+SyntheticSchema::~SyntheticSchema()
+{
+}
+
+void SyntheticSchema::addUsing(const QString& path)
+{
+    _using.append(path);
+}
+
+SyntheticSignal SyntheticSchema::addInput(const QString& name)
+{
+    ID id = nextId();
+
+    _blocks.append(QJsonObject {
+        { "typename", "Buffer" },
+        { "id", double(id) },
+        { "inputs", QJsonArray { name } },
+        { "outputs", QJsonArray { "o" } }
+    });
+
+    _inputs.append(QJsonObject { { "id", double(id) }, { "name", name } });
+    _input_names.append(name);
+
+    return { id, "o" };
+}
+
+void SyntheticSchema::addOutput(const QString& name, const SyntheticSignal& signal)
+{
+    ID id = nextId();
+
+    _blocks.append(QJsonObject {
+        { "typename", "Buffer" },
+        { "id", double(id) },
+        { "inputs", QJsonArray { "i0" } },
+        { "outputs", QJsonArray { name } }
+    });
+
+    connect(signal, id, "i0");
+
+    _outputs.append(QJsonObject { { "id", double(id) }, { "name", name } });
+    _output_names.append(name);
+}
+
+SyntheticSignal SyntheticSchema::addGate(const QString& type_name, const QList<SyntheticSignal>& inputs)
+{
+    ID id = nextId();
+    QJsonArray ports;
+
+    for(int i = 0; i < inputs.size(); i++)
+    {
+        ports.append("i" + QString::number(i));
+    }
+
+    _blocks.append(QJsonObject {
+        { "typename", type_name },
+        { "id", double(id) },
+        { "inputs", ports },
+        { "outputs", QJsonArray { "o" } }
+    });
+
+    for(int i = 0; i < inputs.size(); i++)
+    {
+        connect(inputs[i], id, "i" + QString::number(i));
+    }
+
+    return { id, "o" };
+}
+
+SyntheticSignal SyntheticSchema::addBusInput(const QString& name, int width)
+{
+    ID id = nextId();
+    QString bits = "[" + QString::number(width) + "]";
+
+    _blocks.append(QJsonObject {
+        { "typename", "Buffer" },
+        { "id", double(id) },
+        { "inputs", QJsonArray { name + bits } },
+        { "outputs", QJsonArray { "o" + bits } }
+    });
+
+    _inputs.append(QJsonObject { { "id", double(id) }, { "name", name } });
+    _input_names.append(name);
+
+    return { id, "o" };
+}
+
+void SyntheticSchema::addBusOutput(const QString& name, const SyntheticSignal& signal, int width)
+{
+    ID id = nextId();
+    QString bits = "[" + QString::number(width) + "]";
+
+    _blocks.append(QJsonObject {
+        { "typename", "Buffer" },
+        { "id", double(id) },
+        { "inputs", QJsonArray { "i0" + bits } },
+        { "outputs", QJsonArray { name + bits } }
+    });
+
+    connect(signal, id, "i0");
+
+    _outputs.append(QJsonObject { { "id", double(id) }, { "name", name } });
+    _output_names.append(name);
+}
+
+SyntheticSignal SyntheticSchema::addBusGate(const QString& type_name, const QList<SyntheticSignal>& inputs, int width)
+{
+    ID id = nextId();
+    QString bits = "[" + QString::number(width) + "]";
+    QJsonArray ports;
+
+    for(int i = 0; i < inputs.size(); i++)
+    {
+        ports.append("i" + QString::number(i) + bits);
+    }
+
+    _blocks.append(QJsonObject {
+        { "typename", type_name },
+        { "id", double(id) },
+        { "inputs", ports },
+        { "outputs", QJsonArray { "o" + bits } }
+    });
+
+    for(int i = 0; i < inputs.size(); i++)
+    {
+        connect(inputs[i], id, "i" + QString::number(i));
+    }
+
+    return { id, "o" };
+}
+
+// The register's input "d" is left open for a signal created later.
+SyntheticSignal SyntheticSchema::addRegister(ID* id)
+{
+    *id = nextId();
+
+    _blocks.append(QJsonObject {
+        { "typename", "Register" },
+        { "id", double(*id) },
+        { "inputs", QJsonArray { "d" } },
+        { "outputs", QJsonArray { "q" } }
+    });
+
+    return { *id, "q" };
+}
+
+ID SyntheticSchema::addCustom(const SyntheticSchema& schema)
+{
+    ID id = nextId();
+
+    _blocks.append(QJsonObject {
+        { "typename", schema.typeName() },
+        { "id", double(id) }
+    });
+
+    return id;
+}
+
+void SyntheticSchema::connect(const SyntheticSignal& from, ID to, const QString& port)
+{
+    _connections.append(QJsonObject {
+        { "input-id", double(to) },
+        { "input-name", port },
+        { "output-id", double(from.id) },
+        { "output-name", from.port }
+    });
+}
+
+const QString& SyntheticSchema::typeName() const
+{
+    return _type_name;
+}
+
+const QStringList& SyntheticSchema::inputNames() const
+{
+    return _input_names;
+}
+
+const QStringList& SyntheticSchema::outputNames() const
+{
+    return _output_names;
+}
+
+QByteArray SyntheticSchema::toJson() const
+{
+    QJsonObject object {
+        { "using", _using },
+        { "typename", _type_name },
+        { "inputs", _inputs },
+        { "outputs", _outputs },
+        { "blocks", _blocks },
+        { "connections", _connections }
+    };
+
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+ID SyntheticSchema::nextId()
+{
+    return _next_id++;
+}
+
+SyntheticGenerator::SyntheticGenerator(const QString& directory):
+    _directory(directory)
+{
+}
+
+SyntheticGenerator::~SyntheticGenerator()
+{
+}
+
+QString SyntheticGenerator::rippleCarryAdder(int bits)
+{
+    const SyntheticSchema& adder = fullAdder();
+    SyntheticSchema schema("RippleAdder" + QString::number(bits));
+    schema.addUsing(fileName(adder.typeName()));
+
+    QList<SyntheticSignal> a, b;
+
+    for(int i = 0; i < bits; i++)
+    {
+        a.append(schema.addInput("a" + QString::number(i)));
+    }
+
+    for(int i = 0; i < bits; i++)
+    {
+        b.append(schema.addInput("b" + QString::number(i)));
+    }
+
+    SyntheticSignal carry = schema.addInput("cin");
+
+    for(int i = 0; i < bits; i++)
+    {
+        ID id = schema.addCustom(adder);
+        schema.connect(a[i], id, "a");
+        schema.connect(b[i], id, "b");
+        schema.connect(carry, id, "cin");
+        schema.addOutput("s" + QString::number(i), { id, "s" });
+        carry = { id, "cout" };
+    }
+
+    schema.addOutput("cout", carry);
+    return write(schema);
+}
+
+QString SyntheticGenerator::carryLookaheadAdder(int bits)
+{
+    const SyntheticSchema& adder = lookaheadBlock4();
+    int groups = (bits + 3) / 4;
+    SyntheticSchema schema("LookaheadAdder" + QString::number(groups * 4));
+    schema.addUsing(fileName(adder.typeName()));
+
+    QList<SyntheticSignal> a, b;
+
+    for(int i = 0; i < groups * 4; i++)
+    {
+        a.append(schema.addInput("a" + QString::number(i)));
+    }
+
+    for(int i = 0; i < groups * 4; i++)
+    {
+        b.append(schema.addInput("b" + QString::number(i)));
+    }
+
+    SyntheticSignal carry = schema.addInput("cin");
+
+    for(int group = 0; group < groups; group++)
+    {
+        ID id = schema.addCustom(adder);
+
+        for(int i = 0; i < 4; i++)
+        {
+            schema.connect(a[group * 4 + i], id, "a" + QString::number(i));
+            schema.connect(b[group * 4 + i], id, "b" + QString::number(i));
+        }
+
+        schema.connect(carry, id, "cin");
+
+        for(int i = 0; i < 4; i++)
+        {
+            schema.addOutput("s" + QString::number(group * 4 + i), { id, "s" + QString::number(i) });
+        }
+
+        carry = { id, "cout" };
+    }
+
+    schema.addOutput("cout", carry);
+    return write(schema);
+}
+
+QString SyntheticGenerator::arrayMultiplier(int bits)
+{
+    const SyntheticSchema& half = halfAdder();
+    const SyntheticSchema& full = fullAdder();
+    SyntheticSchema schema("ArrayMultiplier" + QString::number(bits));
+    schema.addUsing(fileName(half.typeName()));
+    schema.addUsing(fileName(full.typeName()));
+
+    QList<SyntheticSignal> a, b;
+
+    for(int i = 0; i < bits; i++)
+    {
+        a.append(schema.addInput("a" + QString::number(i)));
+    }
+
+    for(int i = 0; i < bits; i++)
+    {
+        b.append(schema.addInput("b" + QString::number(i)));
+    }
+
+    QList<SyntheticSignal> accumulator;
+
+    for(int i = 0; i < bits; i++)
+    {
+        accumulator.append(schema.addGate("And", { a[i], b[0] }));
+    }
+
+    for(int row = 1; row < bits; row++)
+    {
+        SyntheticSignal carry {};
+
+        for(int i = 0; i < bits; i++)
+        {
+            int weight = row + i;
+            SyntheticSignal product = schema.addGate("And", { a[i], b[row] });
+            ID id;
+
+            if (i == 0)
+            {
+                id = schema.addCustom(half);
+                schema.connect(accumulator[weight], id, "a");
+                schema.connect(product, id, "b");
+                carry = { id, "c" };
+            }
+            else if (weight == accumulator.size())
+            {
+                // The first row has no partial sum above its top product.
+                id = schema.addCustom(half);
+                schema.connect(product, id, "a");
+                schema.connect(carry, id, "b");
+                carry = { id, "c" };
+                accumulator.append(SyntheticSignal {});
+            }
+            else
+            {
+                id = schema.addCustom(full);
+                schema.connect(accumulator[weight], id, "a");
+                schema.connect(product, id, "b");
+                schema.connect(carry, id, "cin");
+                carry = { id, "cout" };
+            }
+
+            accumulator[weight] = { id, "s" };
+        }
+
+        accumulator.append(carry);
+    }
+
+    for(int i = 0; i < accumulator.size(); i++)
+    {
+        schema.addOutput("p" + QString::number(i), accumulator[i]);
+    }
+
+    return write(schema);
+}
+
+QString SyntheticGenerator::randomDag(int blocks, int connections, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    SyntheticSchema schema("RandomDag" + QString::number(blocks) + "x" + QString::number(connections));
+
+    QList<SyntheticSignal> drivers;
+    QList<bool> used;
+    int inputs = qMax(1, qMin(64, blocks / 16));
+
+    for(int i = 0; i < inputs; i++)
+    {
+        drivers.append(schema.addInput("x" + QString::number(i)));
+        used.append(true);
+    }
+
+    QList<int> fanin;
+
+    for(int i = 0; i < blocks; i++)
+    {
+        fanin.append(1);
+    }
+
+    for(int i = blocks; i < connections && blocks > 0; i++)
+    {
+        fanin[random.bounded(blocks)]++;
+    }
+
+    for(int i = 0; i < blocks; i++)
+    {
+        QList<SyntheticSignal> sources;
+
+        for(int k = 0; k < fanin[i]; k++)
+        {
+            int source = random.bounded(drivers.size());
+            sources.append(drivers[source]);
+            used[source] = true;
+        }
+
+        QString type_name = fanin[i] == 1
+                ? (random.bounded(2) ? "Not" : "Buffer")
+                : multiphase_types[random.bounded(multiphase_types.size())];
+
+        drivers.append(schema.addGate(type_name, sources));
+        used.append(false);
+    }
+
+    int outputs = 0;
+
+    for(int i = drivers.size() - 1; i >= inputs && outputs < 64; i--)
+    {
+        if (!used[i])
+        {
+            schema.addOutput("y" + QString::number(outputs++), drivers[i]);
+        }
+    }
+
+    if (outputs == 0)
+    {
+        schema.addOutput("y0", drivers.last());
+    }
+
+    return write(schema);
+}
+
+QString SyntheticGenerator::deepHierarchy(int depth)
+{
+    SyntheticSchema level("Level0");
+    level.addOutput("y", level.addGate("Not", { level.addInput("x") }));
+    QString path = write(level);
+
+    for(int i = 1; i < depth; i++)
+    {
+        SyntheticSchema schema("Level" + QString::number(i));
+        schema.addUsing(fileName(level.typeName()));
+
+        ID id = schema.addCustom(level);
+        schema.connect(schema.addInput("x"), id, "x");
+        schema.addOutput("y", schema.addGate("Not", { { id, "y" } }));
+
+        path = write(schema);
+        level = schema;
+    }
+
+    return path;
+}
+
+QString SyntheticGenerator::wideGate(int inputs)
+{
+    SyntheticSchema schema("WideGate" + QString::number(inputs));
+    QList<SyntheticSignal> signals_;
+
+    for(int i = 0; i < inputs; i++)
+    {
+        signals_.append(schema.addInput("x" + QString::number(i)));
+    }
+
+    schema.addOutput("y", schema.addGate("And", signals_));
+    return write(schema);
+}
+
+// `stages` rounds of x = x XOR k on a `width`-bit word, written with bus
+// ports or with one block and connection per bit. Both flatten to the same
+// netlist.
+QString SyntheticGenerator::datapath(int width, int stages, bool buses)
+{
+    SyntheticSchema schema(QString("%1Datapath%2x%3").arg(buses ? "Bus" : "Bit").arg(width).arg(stages));
+
+    if (buses)
+    {
+        SyntheticSignal x = schema.addBusInput("x", width);
+        SyntheticSignal k = schema.addBusInput("k", width);
+
+        for(int stage = 0; stage < stages; stage++)
+        {
+            SyntheticSignal any = schema.addBusGate("Or", { x, k }, width);
+            SyntheticSignal not_both = schema.addBusGate("AndNot", { x, k }, width);
+            x = schema.addBusGate("And", { any, not_both }, width);
+        }
+
+        schema.addBusOutput("y", x, width);
+        return write(schema);
+    }
+
+    QList<SyntheticSignal> x, k;
+
+    for(int bit = 0; bit < width; bit++)
+    {
+        x.append(schema.addInput("x" + QString::number(bit)));
+    }
+
+    for(int bit = 0; bit < width; bit++)
+    {
+        k.append(schema.addInput("k" + QString::number(bit)));
+    }
+
+    for(int stage = 0; stage < stages; stage++)
+    {
+        for(int bit = 0; bit < width; bit++)
+        {
+            x[bit] = xorGate(schema, x[bit], k[bit]);
+        }
+    }
+
+    for(int bit = 0; bit < width; bit++)
+    {
+        schema.addOutput("y" + QString::number(bit), x[bit]);
+    }
+
+    return write(schema);
+}
+
+// A register that adds its input to itself every clock cycle, through a
+// ripple-carry adder.
+QString SyntheticGenerator::accumulator(int bits)
+{
+    const SyntheticSchema& adder = fullAdder();
+    SyntheticSchema schema("Accumulator" + QString::number(bits));
+    schema.addUsing(fileName(adder.typeName()));
+
+    QList<SyntheticSignal> a;
+
+    for(int i = 0; i < bits; i++)
+    {
+        a.append(schema.addInput("a" + QString::number(i)));
+    }
+
+    SyntheticSignal carry = schema.addInput("cin");
+
+    for(int i = 0; i < bits; i++)
+    {
+        ID state;
+        SyntheticSignal q = schema.addRegister(&state);
+        ID id = schema.addCustom(adder);
+        schema.connect(a[i], id, "a");
+        schema.connect(q, id, "b");
+        schema.connect(carry, id, "cin");
+        schema.connect({ id, "s" }, state, "d");
+        schema.addOutput("q" + QString::number(i), q);
+        carry = { id, "cout" };
+    }
+
+    schema.addOutput("cout", carry);
+    return write(schema);
+}
+
+// A ripple-carry adder written once with a parameter and loops, and a top
+// schema that instantiates it with `bits` bits. The files do not grow with
+// `bits`.
+QString SyntheticGenerator::parameterisedAdder(int bits)
+{
+    const SyntheticSchema& adder = fullAdder();
+
+    auto buffer = [](int id, const QString& input, const QString& output)
+    {
+        return QJsonObject {
+            { "typename", "Buffer" },
+            { "id", id },
+            { "inputs", QJsonArray { input } },
+            { "outputs", QJsonArray { output } }
+        };
+    };
+
+    auto io = [](int id, const QString& name)
+    {
+        return QJsonObject { { "id", id }, { "name", name } };
+    };
+
+    auto connection = [](const QJsonValue& input_id, const QString& input_name, const QJsonValue& output_id, const QString& output_name)
+    {
+        return QJsonObject {
+            { "input-id", input_id },
+            { "input-name", input_name },
+            { "output-id", output_id },
+            { "output-name", output_name }
+        };
+    };
+
+    auto loop = [](QJsonObject object, const QJsonValue& from)
+    {
+        object.insert("for", "i");
+        object.insert("from", from);
+        object.insert("to", "N");
+        return object;
+    };
+
+    QJsonObject ripple {
+        { "using", QJsonArray { fileName(adder.typeName()) } },
+        { "typename", "ParamRippleAdder" },
+        { "parameters", QJsonObject { { "N", 4 } } },
+        { "inputs", QJsonArray { io(0, "a"), io(1, "b"), io(2, "cin") } },
+        { "outputs", QJsonArray { io(3, "s"), io(4, "cout") } },
+        { "blocks", QJsonArray {
+            buffer(0, "a[{N}]", "o[{N}]"),
+            buffer(1, "b[{N}]", "o[{N}]"),
+            buffer(2, "cin", "o"),
+            buffer(3, "i[{N}]", "s[{N}]"),
+            buffer(4, "i", "cout"),
+            loop(QJsonObject { { "typename", adder.typeName() }, { "id", "10 + i" } }, 0)
+        } },
+        { "connections", QJsonArray {
+            loop(connection("10 + i", "a", 0, "o[{i}]"), 0),
+            loop(connection("10 + i", "b", 1, "o[{i}]"), 0),
+            connection(10, "cin", 2, "o"),
+            loop(connection("10 + i", "cin", "9 + i", "cout"), 1),
+            loop(connection(3, "i[{i}]", "10 + i", "s"), 0),
+            connection(4, "i", "9 + N", "cout")
+        } }
+    };
+
+    QString width = "[" + QString::number(bits) + "]";
+    QJsonObject top {
+        { "using", QJsonArray { "paramrippleadder.json" } },
+        { "typename", "ParamAdder" + QString::number(bits) },
+        { "inputs", QJsonArray { io(0, "a"), io(1, "b"), io(2, "cin") } },
+        { "outputs", QJsonArray { io(3, "s"), io(4, "cout") } },
+        { "blocks", QJsonArray {
+            buffer(0, "a" + width, "o" + width),
+            buffer(1, "b" + width, "o" + width),
+            buffer(2, "cin", "o"),
+            buffer(3, "i" + width, "s" + width),
+            buffer(4, "i", "cout"),
+            QJsonObject { { "typename", "ParamRippleAdder" }, { "id", 5 }, { "parameters", QJsonObject { { "N", bits } } } }
+        } },
+        { "connections", QJsonArray {
+            connection(5, "a", 0, "o"),
+            connection(5, "b", 1, "o"),
+            connection(5, "cin", 2, "o"),
+            connection(3, "i", 5, "s"),
+            connection(4, "i", 5, "cout")
+        } }
+    };
+
+    QString path;
+
+    for(const QJsonObject& object : { ripple, top })
+    {
+        QFile file(path = _directory + "/" + fileName(object["typename"].toString()));
+
+        if (file.open(QIODevice::WriteOnly))
+        {
+            file.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+        }
+    }
+
+    return path;
+}
+
+const SyntheticSchema& SyntheticGenerator::halfAdder()
+{
+    if (!_library.contains("HalfAdder"))
+    {
+        SyntheticSchema schema("HalfAdder");
+        SyntheticSignal a = schema.addInput("a");
+        SyntheticSignal b = schema.addInput("b");
+
+        schema.addOutput("s", xorGate(schema, a, b));
+        schema.addOutput("c", schema.addGate("And", { a, b }));
+
+        write(schema);
+        _library.insert(schema.typeName(), schema);
+    }
+
+    return _library["HalfAdder"];
+}
+
+const SyntheticSchema& SyntheticGenerator::fullAdder()
+{
+    if (!_library.contains("FullAdder"))
+    {
+        SyntheticSchema schema("FullAdder");
+        SyntheticSignal a = schema.addInput("a");
+        SyntheticSignal b = schema.addInput("b");
+        SyntheticSignal c = schema.addInput("cin");
+
+        SyntheticSignal p = xorGate(schema, a, b);
+        SyntheticSignal g = schema.addGate("And", { a, b });
+        SyntheticSignal t = schema.addGate("And", { p, c });
+
+        schema.addOutput("s", xorGate(schema, p, c));
+        schema.addOutput("cout", schema.addGate("Or", { g, t }));
+
+        write(schema);
+        _library.insert(schema.typeName(), schema);
+    }
+
+    return _library["FullAdder"];
+}
+
+const SyntheticSchema& SyntheticGenerator::lookaheadBlock4()
+{
+    if (!_library.contains("LookaheadBlock4"))
+    {
+        SyntheticSchema schema("LookaheadBlock4");
+        QList<SyntheticSignal> a, b, p, g, c;
+
+        for(int i = 0; i < 4; i++)
+        {
+            a.append(schema.addInput("a" + QString::number(i)));
+        }
+
+        for(int i = 0; i < 4; i++)
+        {
+            b.append(schema.addInput("b" + QString::number(i)));
+        }
+
+        c.append(schema.addInput("cin"));
+
+        for(int i = 0; i < 4; i++)
+        {
+            p.append(xorGate(schema, a[i], b[i]));
+            g.append(schema.addGate("And", { a[i], b[i] }));
+        }
+
+        for(int i = 0; i < 4; i++)
+        {
+            QList<SyntheticSignal> terms = { g[i] };
+
+            for(int j = i - 1; j >= -1; j--)
+            {
+                QList<SyntheticSignal> term;
+
+                for(int k = i; k > j; k--)
+                {
+                    term.append(p[k]);
+                }
+
+                term.append(j >= 0 ? g[j] : c[0]);
+                terms.append(schema.addGate("And", term));
+            }
+
+            c.append(schema.addGate("Or", terms));
+        }
+
+        for(int i = 0; i < 4; i++)
+        {
+            schema.addOutput("s" + QString::number(i), xorGate(schema, p[i], c[i]));
+        }
+
+        schema.addOutput("cout", c[4]);
+
+        write(schema);
+        _library.insert(schema.typeName(), schema);
+    }
+
+    return _library["LookaheadBlock4"];
+}
+
+QString SyntheticGenerator::fileName(const QString& type_name)
+{
+    return type_name.toLower() + ".json";
+}
+
+QString SyntheticGenerator::write(const SyntheticSchema& schema)
+{
+    QString path = _directory + "/" + fileName(schema.typeName());
+    QFile file(path);
+
+    if (file.open(QIODevice::WriteOnly))
+    {
+        file.write(schema.toJson());
+        file.close();
+    }
+
+    return path;
+}
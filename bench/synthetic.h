@@ -0,0 +1,87 @@
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include "../general/block.h"
+
+#include <QList>
+#include <QMap>
+#include <QStringList>
+#include <QJsonArray>
+
+struct SyntheticSignal
+{
+    ID id;
+    QString port;
+};
+
+class SyntheticSchema
+{
+public:
+    SyntheticSchema();
+    SyntheticSchema(const QString&);
+    ~SyntheticSchema();
+
+    void addUsing(const QString&);
+
+    SyntheticSignal addInput(const QString&);
+    void addOutput(const QString&, const SyntheticSignal&);
+
+    SyntheticSignal addGate(const QString&, const QList<SyntheticSignal>&);
+    SyntheticSignal addBusInput(const QString&, int width);
+    void addBusOutput(const QString&, const SyntheticSignal&, int width);
+    SyntheticSignal addBusGate(const QString&, const QList<SyntheticSignal>&, int width);
+    SyntheticSignal addRegister(ID* id);
+    ID addCustom(const SyntheticSchema&);
+    void connect(const SyntheticSignal&, ID, const QString&);
+
+    const QString& typeName() const;
+    const QStringList& inputNames() const;
+    const QStringList& outputNames() const;
+
+    QByteArray toJson() const;
+
+private:
+    ID nextId();
+
+private:
+    ID _next_id;
+    QString _type_name;
+    QStringList _input_names;
+    QStringList _output_names;
+    QJsonArray _using;
+    QJsonArray _inputs;
+    QJsonArray _outputs;
+    QJsonArray _blocks;
+    QJsonArray _connections;
+};
+
+class SyntheticGenerator
+{
+public:
+    SyntheticGenerator(const QString&);
+    ~SyntheticGenerator();
+
+    QString rippleCarryAdder(int bits);
+    QString carryLookaheadAdder(int bits);
+    QString arrayMultiplier(int bits);
+    QString randomDag(int blocks, int connections, quint32 seed);
+    QString deepHierarchy(int depth);
+    QString wideGate(int inputs);
+    QString datapath(int width, int stages, bool buses);
+    QString parameterisedAdder(int bits);
+    QString accumulator(int bits);
+
+private:
+    const SyntheticSchema& halfAdder();
+    const SyntheticSchema& fullAdder();
+    const SyntheticSchema& lookaheadBlock4();
+
+    static QString fileName(const QString&);
+    QString write(const SyntheticSchema&);
+
+private:
+    QString _directory;
+    QMap<QString, SyntheticSchema> _library;
+};
+
+#endif // SYNTHETIC_H
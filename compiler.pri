@@ -0,0 +1,52 @@
+SOURCES += \
+    $$PWD/analysis/reachability.cpp \
+    $$PWD/analysis/structuralhash.cpp \
+    $$PWD/batch/batchcompiler.cpp \
+    $$PWD/coverage/togglereport.cpp \
+    $$PWD/fault/faultsimulator.cpp \
+    $$PWD/general/block.cpp \
+    $$PWD/general/connection.cpp \
+    $$PWD/general/netgraph.cpp \
+    $$PWD/general/schema.cpp \
+    $$PWD/generator/codewriter.cpp \
+    $$PWD/generator/generator.cpp \
+    $$PWD/mapping/lutmapper.cpp \
+    $$PWD/netlist/netlist.cpp \
+    $$PWD/parser/expression.cpp \
+    $$PWD/parser/fatalparseexception.cpp \
+    $$PWD/parser/parser.cpp \
+    $$PWD/parser/parserimpl.cpp \
+    $$PWD/parser/schemalibrary.cpp \
+    $$PWD/profiler/profiler.cpp \
+    $$PWD/watcher/watcher.cpp
+
+HEADERS += \
+    $$PWD/analysis/reachability.h \
+    $$PWD/analysis/structuralhash.h \
+    $$PWD/batch/batchcompiler.h \
+    $$PWD/coverage/togglereport.h \
+    $$PWD/fault/faultsimulator.h \
+    $$PWD/general/block.h \
+    $$PWD/general/connection.h \
+    $$PWD/general/netgraph.h \
+    $$PWD/general/schema.h \
+    $$PWD/generator/codewriter.h \
+    $$PWD/generator/generator.h \
+    $$PWD/generator/runtime/batch.hpp \
+    $$PWD/generator/runtime/simulation.hpp \
+    $$PWD/generator/runtime/static.hpp \
+    $$PWD/generator/runtime/trace.hpp \
+    $$PWD/mapping/lutmapper.h \
+    $$PWD/netlist/netlist.h \
+    $$PWD/parser/expression.h \
+    $$PWD/parser/fatalparseexception.h \
+    $$PWD/parser/parser.h \
+    $$PWD/parser/parserimpl.h \
+    $$PWD/parser/schemalibrary.h \
+    $$PWD/profiler/profiler.h \
+    $$PWD/watcher/watcher.h
+
+RESOURCES += \
+    $$PWD/generator/runtime.qrc
+
+win32: LIBS += -lpsapi
@@ -0,0 +1,138 @@
+#include "togglereport.h"
+
+#include <QFile>
+
+static quint64 readLittleEndian(const QByteArray& data, int offset, int bytes)
+{
+    quint64 value = 0;
+
+    for(int i = 0; i < bytes; i++)
+    {
+        value |= quint64(quint8(data[offset + i])) << (8 * i);
+    }
+
+    return value;
+}
+
+ToggleReport::ToggleReport(const Netlist& netlist):
+    _netlist(netlist),
+    _vectors(0)
+{
+}
+
+ToggleReport::~ToggleReport()
+{
+}
+
+bool ToggleReport::read(const QString& path, QString* error)
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        *error = "Cannot read \"" + path + "\"";
+        return false;
+    }
+
+    QByteArray data = file.readAll();
+
+    if (data.size() < 32 || !data.startsWith("LSCTOGGL") || readLittleEndian(data, 8, 4) != 2)
+    {
+        *error = "\"" + path + "\" is not a toggle count file";
+        return false;
+    }
+
+    int nets = int(readLittleEndian(data, 12, 4));
+
+    if (nets != _netlist.netCount() || data.size() != 32 + 8 * nets)
+    {
+        *error = QString("\"%1\" has %2 net(s), the design has %3").arg(path).arg(nets).arg(_netlist.netCount());
+        return false;
+    }
+
+    // The counts are in net order, which depends on the design and the layout.
+    if (readLittleEndian(data, 16, 8) != _netlist.hash())
+    {
+        *error = QString("\"%1\" was written for another netlist; use the design and --layout it was compiled with").arg(path);
+        return false;
+    }
+
+    _vectors = readLittleEndian(data, 24, 8);
+    _counts.clear();
+
+    for(int net = 0; net < nets; net++)
+    {
+        _counts.append(readLittleEndian(data, 32 + 8 * net, 8));
+    }
+
+    return true;
+}
+
+void ToggleReport::print(std::ostream& out) const
+{
+    QVector<quint64> scope_toggles(_netlist.scopes().size(), 0);
+    QVector<int> scope_nets(_netlist.scopes().size(), 0);
+    int idle = 0, reported = 0;
+
+    out << QString("%1 %2 %3 %4 %5")
+           .arg("scope", -40)
+           .arg("schema", -20)
+           .arg("block", -16)
+           .arg("port", -10)
+           .arg("toggles", 12).toStdString() << std::endl;
+
+    for(int net = 0; net < _netlist.netCount(); net++)
+    {
+        int gate = net - _netlist.inputCount();
+        int scope = gate < 0 ? 0 : _netlist.scope(gate);
+        QString block = gate < 0 ? QString("input") : Netlist::kindName(_netlist.kind(gate)) + QString::number(_netlist.blockId(gate));
+        QString port = gate < 0 ? _netlist.inputName(net) : _netlist.portName(gate);
+
+        if (gate >= 0 && _netlist.kind(gate) == GateKind::CONST0)
+        {
+            continue;
+        }
+
+        idle += _counts[net] == 0 ? 1 : 0;
+        reported++;
+        scope_toggles[scope] += _counts[net];
+        scope_nets[scope]++;
+
+        out << QString("%1 %2 %3 %4 %5")
+               .arg(_netlist.scopes()[scope], -40)
+               .arg(_netlist.scopeType(scope), -20)
+               .arg(block, -16)
+               .arg(port, -10)
+               .arg(_counts[net], 12).toStdString() << std::endl;
+    }
+
+    out << std::endl << QString("%1 %2 %3 %4")
+           .arg("scope", -40)
+           .arg("nets", 8)
+           .arg("toggles", 14)
+           .arg("per vector", 12).toStdString() << std::endl;
+
+    for(int scope = 0; scope < _netlist.scopes().size(); scope++)
+    {
+        out << QString("%1 %2 %3 %4")
+               .arg(_netlist.scopes()[scope], -40)
+               .arg(scope_nets[scope], 8)
+               .arg(scope_toggles[scope], 14)
+               .arg(_vectors ? double(scope_toggles[scope]) / _vectors : 0.0, 12, 'f', 3).toStdString() << std::endl;
+    }
+
+    out << QString("%1 vector(s), %2 idle net(s) out of %3")
+           .arg(_vectors)
+           .arg(idle)
+           .arg(reported).toStdString() << std::endl;
+}
+
+quint64 ToggleReport::vectors() const
+{
+    return _vectors;
+}
+
+const QVector<quint64>& ToggleReport::counts() const
+{
+    return _counts;
+}
@@ -0,0 +1,26 @@
+#ifndef TOGGLEREPORT_H
+#define TOGGLEREPORT_H
+
+#include "../netlist/netlist.h"
+
+#include <ostream>
+
+class ToggleReport
+{
+public:
+    ToggleReport(const Netlist&);
+    ~ToggleReport();
+
+    bool read(const QString&, QString* error);
+    void print(std::ostream&) const;
+
+    quint64 vectors() const;
+    const QVector<quint64>& counts() const;
+
+private:
+    const Netlist& _netlist;
+    quint64 _vectors;
+    QVector<quint64> _counts;
+};
+
+#endif // TOGGLEREPORT_H
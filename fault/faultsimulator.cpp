@@ -0,0 +1,450 @@
+#include "faultsimulator.h"
+
+#include "../profiler/profiler.h"
+
+#include <QFile>
+#include <QRandomGenerator>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+static int lowestBit(quint64 value)
+{
+    int bit = 0;
+
+    while (!(value & 1))
+    {
+        value >>= 1;
+        bit++;
+    }
+
+    return bit;
+}
+
+FaultSimulator::FaultSimulator(const Netlist& netlist):
+    _netlist(netlist),
+    _fanout_offsets(netlist.netCount() + 1, 0),
+    _is_output(netlist.netCount(), 0),
+    _detected(0),
+    _patterns(0)
+{
+    for(int gate = 0; gate < netlist.gateCount(); gate++)
+    {
+        if (netlist.kind(gate) == GateKind::CONST0)
+        {
+            continue;
+        }
+
+        _faults.append({ gate, -1, false, false, -1 });
+        _faults.append({ gate, -1, true, false, -1 });
+
+        for(int pin = 0; pin < netlist.faninCount(gate); pin++)
+        {
+            _faults.append({ gate, pin, false, false, -1 });
+            _faults.append({ gate, pin, true, false, -1 });
+            _fanout_offsets[netlist.fanin(gate)[pin] + 1]++;
+        }
+    }
+
+    for(int net = 0; net < netlist.netCount(); net++)
+    {
+        _fanout_offsets[net + 1] += _fanout_offsets[net];
+    }
+
+    QVector<int> fill = _fanout_offsets;
+    _fanout = QVector<int>(_fanout_offsets.last());
+
+    for(int gate = 0; gate < netlist.gateCount(); gate++)
+    {
+        for(int pin = 0; pin < netlist.faninCount(gate); pin++)
+        {
+            _fanout[fill[netlist.fanin(gate)[pin]]++] = gate;
+        }
+    }
+
+    for(int output = 0; output < netlist.outputCount(); output++)
+    {
+        _is_output[netlist.outputNet(output)] = 1;
+    }
+}
+
+FaultSimulator::~FaultSimulator()
+{
+}
+
+QList<PatternBlock> FaultSimulator::randomPatterns(int inputs, qint64 count, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    QList<PatternBlock> blocks;
+
+    for(qint64 base = 0; base < count; base += 64)
+    {
+        PatternBlock block;
+        block.count = int(qMin<qint64>(64, count - base));
+
+        for(int i = 0; i < inputs; i++)
+        {
+            block.inputs.append(random.generate64());
+        }
+
+        blocks.append(block);
+    }
+
+    return blocks;
+}
+
+bool FaultSimulator::readPatterns(const QString& path, int inputs, QList<PatternBlock>& blocks, QString* error)
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        *error = "Cannot read \"" + path + "\"";
+        return false;
+    }
+
+    QByteArray data = file.readAll();
+    QList<QVector<bool>> vectors;
+
+    if (path.endsWith(".bin"))
+    {
+        int stride = (inputs + 7) / 8;
+
+        for(int offset = 0; stride > 0 && offset + stride <= data.size(); offset += stride)
+        {
+            QVector<bool> vector;
+
+            for(int i = 0; i < inputs; i++)
+            {
+                vector.append((quint8(data[offset + i / 8]) >> (i % 8)) & 1);
+            }
+
+            vectors.append(vector);
+        }
+    }
+    else
+    {
+        int number = 0;
+
+        for(const QByteArray& line : data.split('\n'))
+        {
+            QVector<bool> vector;
+            number++;
+
+            for(char c : line)
+            {
+                if (c == '0' || c == '1')
+                {
+                    vector.append(c == '1');
+                }
+                else if (c == '#' || (vector.isEmpty() && (std::isalpha(quint8(c)) || c == '_')))
+                {
+                    break;
+                }
+            }
+
+            if (vector.isEmpty())
+            {
+                continue;
+            }
+
+            if (vector.size() != inputs)
+            {
+                *error = QString("%1:%2: expected %3 value(s), got %4").arg(path).arg(number).arg(inputs).arg(vector.size());
+                return false;
+            }
+
+            vectors.append(vector);
+        }
+    }
+
+    for(int base = 0; base < vectors.size(); base += 64)
+    {
+        PatternBlock block;
+        block.count = qMin(64, vectors.size() - base);
+        block.inputs = QVector<quint64>(inputs, 0);
+
+        for(int v = 0; v < block.count; v++)
+        {
+            for(int i = 0; i < inputs; i++)
+            {
+                block.inputs[i] |= quint64(vectors[base + v][i]) << v;
+            }
+        }
+
+        blocks.append(block);
+    }
+
+    return true;
+}
+
+void FaultSimulator::run(const QList<PatternBlock>& blocks, int threads)
+{
+    ScopedTimer timer("fault simulation");
+
+    threads = qMax(1, threads);
+
+    QVector<int> remaining;
+    QVector<quint64> good(_netlist.netCount());
+    QVector<Worker> workers(threads);
+    QThreadPool pool;
+
+    pool.setMaxThreadCount(threads);
+
+    for(int i = 0; i < _faults.size(); i++)
+    {
+        if (!_faults[i].detected)
+        {
+            remaining.append(i);
+        }
+    }
+
+    for(Worker& worker : workers)
+    {
+        worker.faulty = QVector<quint64>(_netlist.netCount());
+        worker.stamp = QVector<quint32>(_netlist.netCount(), 0);
+        worker.scheduled = QVector<quint32>(_netlist.gateCount(), 0);
+    }
+
+    for(const PatternBlock& block : blocks)
+    {
+        if (remaining.isEmpty())
+        {
+            break;
+        }
+
+        simulate(block, good);
+
+        quint64 mask = block.count >= 64 ? ~quint64(0) : (quint64(1) << block.count) - 1;
+        qint64 base = _patterns;
+        int slice = (remaining.size() + threads - 1) / threads;
+
+        auto work = [&, mask, base, slice](int t)
+        {
+            for(int i = t * slice; i < qMin(remaining.size(), (t + 1) * slice); i++)
+            {
+                Fault& fault = _faults[remaining[i]];
+
+                if (detect(fault, good, mask, workers[t]))
+                {
+                    fault.pattern += base;
+                }
+            }
+        };
+
+        if (threads == 1 || remaining.size() < 64)
+        {
+            work(0);
+        }
+        else
+        {
+            for(int t = 0; t < threads; t++)
+            {
+                pool.start([&work, t]() { work(t); });
+            }
+
+            pool.waitForDone();
+        }
+
+        QVector<int> undetected;
+
+        for(int index : remaining)
+        {
+            if (!_faults[index].detected)
+            {
+                undetected.append(index);
+            }
+        }
+
+        _detected += remaining.size() - undetected.size();
+        _patterns += block.count;
+        remaining = undetected;
+    }
+}
+
+const QVector<Fault>& FaultSimulator::faults() const
+{
+    return _faults;
+}
+
+int FaultSimulator::detected() const
+{
+    return _detected;
+}
+
+double FaultSimulator::coverage() const
+{
+    return _faults.isEmpty() ? 100.0 : 100.0 * _detected / _faults.size();
+}
+
+qint64 FaultSimulator::patterns() const
+{
+    return _patterns;
+}
+
+QString FaultSimulator::faultName(const Fault& fault) const
+{
+    QString port = fault.pin == -1 ? QString("out") : "in" + QString::number(fault.pin);
+    return _netlist.netName(_netlist.net(fault.gate)) + "." + port + " stuck-at-" + (fault.stuck_at ? "1" : "0");
+}
+
+void FaultSimulator::report(std::ostream& out, int limit) const
+{
+    out << QString("Fault simulation: %1 fault(s), %2 detected, coverage %3%, %4 pattern(s)")
+           .arg(_faults.size())
+           .arg(_detected)
+           .arg(coverage(), 0, 'f', 2)
+           .arg(_patterns).toStdString() << std::endl;
+
+    int listed = 0, undetected = _faults.size() - _detected;
+
+    for(const Fault& fault : _faults)
+    {
+        if (!fault.detected && (limit < 0 || listed < limit))
+        {
+            out << "  undetected: " << faultName(fault).toStdString() << std::endl;
+            listed++;
+        }
+    }
+
+    if (listed < undetected)
+    {
+        out << "  ... " << undetected - listed << " more undetected fault(s)" << std::endl;
+    }
+}
+
+quint64 FaultSimulator::evaluate(int gate, const quint64* values, const Worker* worker, int forced_pin, quint64 forced) const
+{
+    const int* fanin = _netlist.fanin(gate);
+    int count = _netlist.faninCount(gate);
+
+    auto input = [&](int pin)
+    {
+        int net = fanin[pin];
+        return pin == forced_pin ? forced
+             : worker && worker->stamp[net] == worker->epoch ? worker->faulty[net]
+             : values[net];
+    };
+
+    quint64 value = 0;
+
+    switch (_netlist.kind(gate))
+    {
+    case GateKind::CONST0:
+    case GateKind::REGISTER:
+        return 0;
+    case GateKind::BUFFER:
+        return input(0);
+    case GateKind::NOT:
+        return ~input(0);
+    case GateKind::AND:
+    case GateKind::NAND:
+        value = ~quint64(0);
+
+        for(int pin = 0; pin < count; pin++)
+        {
+            value &= input(pin);
+        }
+
+        return _netlist.kind(gate) == GateKind::NAND ? ~value : value;
+    case GateKind::OR:
+    case GateKind::NOR:
+        for(int pin = 0; pin < count; pin++)
+        {
+            value |= input(pin);
+        }
+
+        return _netlist.kind(gate) == GateKind::NOR ? ~value : value;
+    }
+
+    return value;
+}
+
+void FaultSimulator::simulate(const PatternBlock& block, QVector<quint64>& good) const
+{
+    for(int input = 0; input < _netlist.inputCount(); input++)
+    {
+        good[input] = block.inputs[input];
+    }
+
+    for(int gate = 0; gate < _netlist.gateCount(); gate++)
+    {
+        good[_netlist.net(gate)] = evaluate(gate, good.constData(), nullptr, -1, 0);
+    }
+}
+
+// Injects the fault, then re-evaluates only the gates in its fanout cone,
+// in topological order, until an output differs or the effect dies out.
+bool FaultSimulator::detect(Fault& fault, const QVector<quint64>& good, quint64 mask, Worker& worker) const
+{
+    int site = _netlist.net(fault.gate);
+    quint64 stuck = fault.stuck_at ? ~quint64(0) : 0;
+    quint64 value = fault.pin == -1 ? stuck : evaluate(fault.gate, good.constData(), nullptr, fault.pin, stuck);
+
+    if (!((value ^ good[site]) & mask))
+    {
+        return false;
+    }
+
+    if (++worker.epoch == 0)
+    {
+        worker.stamp.fill(0);
+        worker.scheduled.fill(0);
+        worker.epoch = 1;
+    }
+
+    worker.heap.clear();
+
+    auto change = [&](int net, quint64 faulty)
+    {
+        quint64 difference = (faulty ^ good[net]) & mask;
+
+        worker.faulty[net] = faulty;
+        worker.stamp[net] = worker.epoch;
+
+        if (_is_output[net])
+        {
+            fault.detected = true;
+            fault.pattern = lowestBit(difference);
+            return true;
+        }
+
+        for(int i = _fanout_offsets[net]; i < _fanout_offsets[net + 1]; i++)
+        {
+            int sink = _fanout[i];
+
+            if (worker.scheduled[sink] != worker.epoch)
+            {
+                worker.scheduled[sink] = worker.epoch;
+                worker.heap.append(sink);
+                std::push_heap(worker.heap.begin(), worker.heap.end(), std::greater<int>());
+            }
+        }
+
+        return false;
+    };
+
+    if (change(site, value))
+    {
+        return true;
+    }
+
+    while (!worker.heap.isEmpty())
+    {
+        std::pop_heap(worker.heap.begin(), worker.heap.end(), std::greater<int>());
+        int gate = worker.heap.last();
+        worker.heap.removeLast();
+
+        int net = _netlist.net(gate);
+        quint64 faulty = evaluate(gate, good.constData(), &worker, -1, 0);
+
+        if (((faulty ^ good[net]) & mask) && change(net, faulty))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
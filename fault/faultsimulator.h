@@ -0,0 +1,65 @@
+#ifndef FAULTSIMULATOR_H
+#define FAULTSIMULATOR_H
+
+#include "../netlist/netlist.h"
+
+#include <ostream>
+
+struct Fault
+{
+    int gate;
+    int pin;
+    bool stuck_at;
+    bool detected;
+    qint64 pattern;
+};
+
+struct PatternBlock
+{
+    QVector<quint64> inputs;
+    int count;
+};
+
+class FaultSimulator
+{
+public:
+    FaultSimulator(const Netlist&);
+    ~FaultSimulator();
+
+    static QList<PatternBlock> randomPatterns(int inputs, qint64 count, quint32 seed);
+    static bool readPatterns(const QString&, int inputs, QList<PatternBlock>&, QString* error);
+
+    void run(const QList<PatternBlock>&, int threads);
+
+    const QVector<Fault>& faults() const;
+    int detected() const;
+    double coverage() const;
+    qint64 patterns() const;
+    QString faultName(const Fault&) const;
+    void report(std::ostream&, int limit) const;
+
+private:
+    struct Worker
+    {
+        QVector<quint64> faulty;
+        QVector<quint32> stamp;
+        QVector<quint32> scheduled;
+        QVector<int> heap;
+        quint32 epoch = 0;
+    };
+
+    quint64 evaluate(int gate, const quint64* values, const Worker*, int forced_pin, quint64 forced) const;
+    void simulate(const PatternBlock&, QVector<quint64>& good) const;
+    bool detect(Fault&, const QVector<quint64>& good, quint64 mask, Worker&) const;
+
+private:
+    const Netlist& _netlist;
+    QVector<Fault> _faults;
+    QVector<int> _fanout_offsets;
+    QVector<int> _fanout;
+    QVector<char> _is_output;
+    int _detected;
+    qint64 _patterns;
+};
+
+#endif // FAULTSIMULATOR_H
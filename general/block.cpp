@@ -4,7 +4,9 @@ Block::Block():
     _type(BlockType::CUSTOM),
     _type_name(),
     _inputs(),
-    _outputs()
+    _outputs(),
+    _input_widths(),
+    _output_widths()
 {  
 }
 
@@ -32,6 +34,16 @@ void Block::setOutputs(const QStringList& outputs)
     _outputs = outputs;
 }
 
+void Block::setInputWidths(const QVector<int>& widths)
+{
+    _input_widths = widths;
+}
+
+void Block::setOutputWidths(const QVector<int>& widths)
+{
+    _output_widths = widths;
+}
+
 BlockType Block::type() const
 {
     return _type;
@@ -51,3 +63,14 @@ const QStringList &Block::outputs() const
 {
     return _outputs;
 }
+
+// Ports without an explicit width are single bits.
+int Block::inputWidth(int port) const
+{
+    return _input_widths.value(port, 1);
+}
+
+int Block::outputWidth(int port) const
+{
+    return _output_widths.value(port, 1);
+}
@@ -5,11 +5,13 @@ using ID = unsigned long long int;
 
 #include <QMap>
 #include <QString>
+#include <QVector>
 
 enum class BlockType
 {
     MONOPHASE,
     MULTIPHASE,
+    SEQUENTIAL,
     CUSTOM
 };
 
@@ -23,17 +25,23 @@ public:
     void setTypeName(const QString&);
     void setInputs(const QStringList&);
     void setOutputs(const QStringList&);
+    void setInputWidths(const QVector<int>&);
+    void setOutputWidths(const QVector<int>&);
 
     BlockType type() const;
     const QString& typeName() const;
     const QStringList& inputs() const;
     const QStringList& outputs() const;
+    int inputWidth(int port) const;
+    int outputWidth(int port) const;
 
 private:
     BlockType _type;
     QString _type_name;
     QStringList _inputs;
     QStringList _outputs;
+    QVector<int> _input_widths;
+    QVector<int> _output_widths;
 };
 
 #endif // BLOCK_H
@@ -4,7 +4,11 @@ Connection::Connection():
     _input_id(0),
     _input_name(),
     _output_id(0),
-    _output_name()
+    _output_name(),
+    _input_lsb(0),
+    _input_width(-1),
+    _output_lsb(0),
+    _output_width(-1)
 {
 }
 
@@ -32,6 +36,20 @@ void Connection::setOutputName(const QString& name)
     _output_name = name;
 }
 
+// A width of -1 selects the whole port; validation replaces it with the
+// port's width.
+void Connection::setInputSlice(int lsb, int width)
+{
+    _input_lsb = lsb;
+    _input_width = width;
+}
+
+void Connection::setOutputSlice(int lsb, int width)
+{
+    _output_lsb = lsb;
+    _output_width = width;
+}
+
 ID Connection::inputID() const
 {
     return _input_id;
@@ -51,3 +69,23 @@ const QString& Connection::outputName() const
 {
     return _output_name;
 }
+
+int Connection::inputLsb() const
+{
+    return _input_lsb;
+}
+
+int Connection::inputWidth() const
+{
+    return _input_width;
+}
+
+int Connection::outputLsb() const
+{
+    return _output_lsb;
+}
+
+int Connection::outputWidth() const
+{
+    return _output_width;
+}
@@ -13,17 +13,27 @@ public:
     void setInputName(const QString&);
     void setOuputId(const ID&);
     void setOutputName(const QString&);
+    void setInputSlice(int lsb, int width);
+    void setOutputSlice(int lsb, int width);
 
     ID inputID() const;
     const QString& inputName() const;
     ID outputID() const;
     const QString& outputName() const;
+    int inputLsb() const;
+    int inputWidth() const;
+    int outputLsb() const;
+    int outputWidth() const;
 
 private:
     ID _input_id;
     QString _input_name;
     ID _output_id;
     QString _output_name;
+    int _input_lsb;
+    int _input_width;
+    int _output_lsb;
+    int _output_width;
 };
 
 #endif // CONNECTION_H
@@ -0,0 +1,286 @@
+#include "netgraph.h"
+
+#include <algorithm>
+
+NetGraph::NetGraph():
+    _input_offsets(1, 0),
+    _output_offsets(1, 0),
+    _input_ports(1, 0),
+    _output_ports(1, 0),
+    _fanin_offsets(1, 0),
+    _fanout_offsets(1, 0)
+{
+}
+
+// Every bit of a port is a pin of its own. Ports are numbered per graph,
+// and the pins of a port are consecutive.
+NetGraph::NetGraph(const QMap<ID, std::shared_ptr<Block>>& blocks):
+    NetGraph()
+{
+    _ids.reserve(blocks.size());
+    _input_offsets.reserve(blocks.size() + 1);
+    _output_offsets.reserve(blocks.size() + 1);
+
+    for(auto it = blocks.constBegin(); it != blocks.constEnd(); ++it)
+    {
+        int block = _ids.size();
+        _ids.append(it.key());
+
+        for(int port = 0; port < it.value()->inputs().size(); port++)
+        {
+            for(int bit = 0; bit < it.value()->inputWidth(port); bit++)
+            {
+                _input_blocks.append(block);
+                _input_pin_ports.append(_input_ports.size() - 1);
+            }
+
+            _input_ports.append(_input_blocks.size());
+        }
+
+        for(int port = 0; port < it.value()->outputs().size(); port++)
+        {
+            for(int bit = 0; bit < it.value()->outputWidth(port); bit++)
+            {
+                _output_blocks.append(block);
+                _output_pin_ports.append(_output_ports.size() - 1);
+            }
+
+            _output_ports.append(_output_blocks.size());
+        }
+
+        _input_offsets.append(_input_ports.size() - 1);
+        _output_offsets.append(_output_ports.size() - 1);
+    }
+}
+
+NetGraph::~NetGraph()
+{
+}
+
+void NetGraph::connect(int output_pin, int input_pin)
+{
+    _edge_outputs.append(output_pin);
+    _edge_inputs.append(input_pin);
+}
+
+void NetGraph::addGlobalInput(int input_pin)
+{
+    _global_inputs.append(input_pin);
+}
+
+void NetGraph::addGlobalOutput(int output_pin)
+{
+    _global_outputs.append(output_pin);
+}
+
+void NetGraph::build()
+{
+    QVector<int> fanin_fill(inputPinCount() + 1, 0);
+    QVector<int> fanout_fill(outputPinCount() + 1, 0);
+    QVector<char> global(inputPinCount(), 0);
+
+    for(int i = 0; i < _edge_inputs.size(); i++)
+    {
+        fanin_fill[_edge_inputs[i] + 1]++;
+        fanout_fill[_edge_outputs[i] + 1]++;
+    }
+
+    for(int i = 0; i < inputPinCount(); i++)
+    {
+        fanin_fill[i + 1] += fanin_fill[i];
+    }
+
+    for(int i = 0; i < outputPinCount(); i++)
+    {
+        fanout_fill[i + 1] += fanout_fill[i];
+    }
+
+    _fanin_offsets = fanin_fill;
+    _fanout_offsets = fanout_fill;
+    _fanin = QVector<int>(_edge_inputs.size());
+    _fanout = QVector<int>(_edge_outputs.size());
+
+    for(int i = 0; i < _edge_inputs.size(); i++)
+    {
+        _fanin[fanin_fill[_edge_inputs[i]]++] = _edge_outputs[i];
+        _fanout[fanout_fill[_edge_outputs[i]]++] = _edge_inputs[i];
+    }
+
+    _edge_inputs = QVector<int>();
+    _edge_outputs = QVector<int>();
+
+    for(int pin : _global_inputs)
+    {
+        global[pin]++;
+    }
+
+    _multiple_drivers.clear();
+    _unconnected_inputs.clear();
+
+    for(int pin = 0; pin < inputPinCount(); pin++)
+    {
+        int drivers = faninCount(pin) + global[pin];
+
+        if (drivers > 1)
+        {
+            _multiple_drivers.append(pin);
+        }
+        else if (drivers == 0)
+        {
+            _unconnected_inputs.append(pin);
+        }
+    }
+}
+
+int NetGraph::blockCount() const
+{
+    return _ids.size();
+}
+
+int NetGraph::index(ID id) const
+{
+    auto it = std::lower_bound(_ids.begin(), _ids.end(), id);
+    return it != _ids.end() && *it == id ? int(it - _ids.begin()) : -1;
+}
+
+ID NetGraph::id(int block) const
+{
+    return _ids[block];
+}
+
+int NetGraph::inputPinCount() const
+{
+    return _input_blocks.size();
+}
+
+int NetGraph::outputPinCount() const
+{
+    return _output_blocks.size();
+}
+
+int NetGraph::inputPinCount(int block) const
+{
+    return _input_ports[_input_offsets[block + 1]] - _input_ports[_input_offsets[block]];
+}
+
+int NetGraph::outputPinCount(int block) const
+{
+    return _output_ports[_output_offsets[block + 1]] - _output_ports[_output_offsets[block]];
+}
+
+int NetGraph::inputPin(int block, int port) const
+{
+    return _input_ports[_input_offsets[block] + port];
+}
+
+int NetGraph::outputPin(int block, int port) const
+{
+    return _output_ports[_output_offsets[block] + port];
+}
+
+int NetGraph::inputCount(int block) const
+{
+    return _input_offsets[block + 1] - _input_offsets[block];
+}
+
+int NetGraph::outputCount(int block) const
+{
+    return _output_offsets[block + 1] - _output_offsets[block];
+}
+
+int NetGraph::inputWidth(int block, int port) const
+{
+    int index = _input_offsets[block] + port;
+    return _input_ports[index + 1] - _input_ports[index];
+}
+
+int NetGraph::outputWidth(int block, int port) const
+{
+    int index = _output_offsets[block] + port;
+    return _output_ports[index + 1] - _output_ports[index];
+}
+
+int NetGraph::inputBlock(int input_pin) const
+{
+    return _input_blocks[input_pin];
+}
+
+int NetGraph::outputBlock(int output_pin) const
+{
+    return _output_blocks[output_pin];
+}
+
+int NetGraph::inputPort(int input_pin) const
+{
+    return _input_pin_ports[input_pin] - _input_offsets[_input_blocks[input_pin]];
+}
+
+int NetGraph::outputPort(int output_pin) const
+{
+    return _output_pin_ports[output_pin] - _output_offsets[_output_blocks[output_pin]];
+}
+
+int NetGraph::inputBit(int input_pin) const
+{
+    return input_pin - _input_ports[_input_pin_ports[input_pin]];
+}
+
+int NetGraph::outputBit(int output_pin) const
+{
+    return output_pin - _output_ports[_output_pin_ports[output_pin]];
+}
+
+int NetGraph::inputIndex(int input_pin) const
+{
+    return input_pin - inputPin(_input_blocks[input_pin], 0);
+}
+
+int NetGraph::outputIndex(int output_pin) const
+{
+    return output_pin - outputPin(_output_blocks[output_pin], 0);
+}
+
+int NetGraph::faninCount(int input_pin) const
+{
+    return _fanin_offsets[input_pin + 1] - _fanin_offsets[input_pin];
+}
+
+const int* NetGraph::fanin(int input_pin) const
+{
+    return _fanin.constData() + _fanin_offsets[input_pin];
+}
+
+int NetGraph::driver(int input_pin) const
+{
+    return faninCount(input_pin) > 0 ? *fanin(input_pin) : -1;
+}
+
+int NetGraph::fanoutCount(int output_pin) const
+{
+    return _fanout_offsets[output_pin + 1] - _fanout_offsets[output_pin];
+}
+
+const int* NetGraph::fanout(int output_pin) const
+{
+    return _fanout.constData() + _fanout_offsets[output_pin];
+}
+
+const QVector<int>& NetGraph::globalInputs() const
+{
+    return _global_inputs;
+}
+
+const QVector<int>& NetGraph::globalOutputs() const
+{
+    return _global_outputs;
+}
+
+const QVector<int>& NetGraph::multipleDrivers() const
+{
+    return _multiple_drivers;
+}
+
+const QVector<int>& NetGraph::unconnectedInputs() const
+{
+    return _unconnected_inputs;
+}
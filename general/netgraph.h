@@ -0,0 +1,80 @@
+#ifndef NETGRAPH_H
+#define NETGRAPH_H
+
+#include "block.h"
+
+#include <memory>
+#include <QVector>
+
+class NetGraph
+{
+public:
+    NetGraph();
+    NetGraph(const QMap<ID, std::shared_ptr<Block>>&);
+    ~NetGraph();
+
+    void connect(int output_pin, int input_pin);
+    void addGlobalInput(int input_pin);
+    void addGlobalOutput(int output_pin);
+    void build();
+
+    int blockCount() const;
+    int index(ID) const;
+    ID id(int block) const;
+
+    int inputPinCount() const;
+    int outputPinCount() const;
+    int inputPinCount(int block) const;
+    int outputPinCount(int block) const;
+    int inputPin(int block, int port) const;
+    int outputPin(int block, int port) const;
+    int inputCount(int block) const;
+    int outputCount(int block) const;
+    int inputWidth(int block, int port) const;
+    int outputWidth(int block, int port) const;
+    int inputBlock(int input_pin) const;
+    int outputBlock(int output_pin) const;
+    int inputPort(int input_pin) const;
+    int outputPort(int output_pin) const;
+    int inputBit(int input_pin) const;
+    int outputBit(int output_pin) const;
+    int inputIndex(int input_pin) const;
+    int outputIndex(int output_pin) const;
+
+    int faninCount(int input_pin) const;
+    const int* fanin(int input_pin) const;
+    int driver(int input_pin) const;
+    int fanoutCount(int output_pin) const;
+    const int* fanout(int output_pin) const;
+
+    const QVector<int>& globalInputs() const;
+    const QVector<int>& globalOutputs() const;
+    const QVector<int>& multipleDrivers() const;
+    const QVector<int>& unconnectedInputs() const;
+
+private:
+    QVector<ID> _ids;
+    QVector<int> _input_offsets;
+    QVector<int> _output_offsets;
+    QVector<int> _input_ports;
+    QVector<int> _output_ports;
+    QVector<int> _input_blocks;
+    QVector<int> _output_blocks;
+    QVector<int> _input_pin_ports;
+    QVector<int> _output_pin_ports;
+
+    QVector<int> _edge_outputs;
+    QVector<int> _edge_inputs;
+
+    QVector<int> _fanin_offsets;
+    QVector<int> _fanin;
+    QVector<int> _fanout_offsets;
+    QVector<int> _fanout;
+
+    QVector<int> _global_inputs;
+    QVector<int> _global_outputs;
+    QVector<int> _multiple_drivers;
+    QVector<int> _unconnected_inputs;
+};
+
+#endif // NETGRAPH_H
@@ -4,8 +4,14 @@ Schema::Schema():
     _type_name(),
     _inputs(),
     _outputs(),
+    _input_widths(),
+    _output_widths(),
     _blocks(),
-    _connections()
+    _connections(),
+    _interface(false),
+    _graph(),
+    _parameters(),
+    _definition()
 {   
 }
 
@@ -28,6 +34,16 @@ void Schema::setOutputs(const QList<QPair<ID, QString>>& outputs)
     _outputs = outputs;
 }
 
+void Schema::setInputWidths(const QVector<int>& widths)
+{
+    _input_widths = widths;
+}
+
+void Schema::setOutputWidths(const QVector<int>& widths)
+{
+    _output_widths = widths;
+}
+
 void Schema::setBlocks(const QMap<ID, SharedPtr<Block>>& blocks)
 {
     _blocks = blocks;
@@ -38,6 +54,11 @@ void Schema::setConnections(const QList<SharedPtr<Connection>>& connections)
     _connections = connections;
 }
 
+void Schema::setInterface(bool interface_only)
+{
+    _interface = interface_only;
+}
+
 const QString& Schema::typeName() const
 {
     return _type_name;
@@ -53,6 +74,16 @@ const QList<QPair<ID, QString>>& Schema::outputs() const
     return _outputs;
 }
 
+const QVector<int>& Schema::inputWidths() const
+{
+    return _input_widths;
+}
+
+const QVector<int>& Schema::outputWidths() const
+{
+    return _output_widths;
+}
+
 const QMap<ID, SharedPtr<Block>>& Schema::blocks() const
 {
     return _blocks;
@@ -62,3 +93,40 @@ const QList<SharedPtr<Connection>>& Schema::connections() const
 {
     return _connections;
 }
+
+bool Schema::isInterface() const
+{
+    return _interface;
+}
+
+void Schema::setGraph(const NetGraph& graph)
+{
+    _graph = graph;
+}
+
+const NetGraph& Schema::graph() const
+{
+    return _graph;
+}
+
+// A parameterised schema keeps its JSON so that it can be expanded again
+// with other parameter values.
+void Schema::setParameters(const QMap<QString, qint64>& parameters)
+{
+    _parameters = parameters;
+}
+
+void Schema::setDefinition(const QJsonObject& definition)
+{
+    _definition = definition;
+}
+
+const QMap<QString, qint64>& Schema::parameters() const
+{
+    return _parameters;
+}
+
+const QJsonObject& Schema::definition() const
+{
+    return _definition;
+}
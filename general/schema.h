@@ -3,8 +3,10 @@
 
 #include "block.h"
 #include "connection.h"
+#include "netgraph.h"
 
 #include <memory>
+#include <QJsonObject>
 #include <QList>
 #include <QSet>
 
@@ -23,21 +25,39 @@ public:
     void setTypeName(const QString&);
     void setInputs(const QList<QPair<ID, QString>>&);
     void setOutputs(const QList<QPair<ID, QString>>&);
+    void setInputWidths(const QVector<int>&);
+    void setOutputWidths(const QVector<int>&);
     void setBlocks(const QMap<ID, SharedPtr<Block>>&);
     void setConnections(const QList<SharedPtr<Connection>>&);
+    void setInterface(bool);
+    void setGraph(const NetGraph&);
+    void setParameters(const QMap<QString, qint64>&);
+    void setDefinition(const QJsonObject&);
 
     const QString& typeName() const;
     const QList<QPair<ID, QString>>& inputs() const;
     const QList<QPair<ID, QString>>& outputs() const;
+    const QVector<int>& inputWidths() const;
+    const QVector<int>& outputWidths() const;
     const QMap<ID, SharedPtr<Block>>& blocks() const;
     const QList<SharedPtr<Connection>>& connections() const;
+    bool isInterface() const;
+    const NetGraph& graph() const;
+    const QMap<QString, qint64>& parameters() const;
+    const QJsonObject& definition() const;
 
 private:
     QString _type_name;
     QList<QPair<ID, QString>> _inputs;
     QList<QPair<ID, QString>> _outputs;
+    QVector<int> _input_widths;
+    QVector<int> _output_widths;
     QMap<ID, SharedPtr<Block>> _blocks;
     QList<SharedPtr<Connection>> _connections;
+    bool _interface;
+    NetGraph _graph;
+    QMap<QString, qint64> _parameters;
+    QJsonObject _definition;
 };
 
 #endif // SCHEMA_H
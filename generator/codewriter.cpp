@@ -0,0 +1,132 @@
+#include "codewriter.h"
+
+#include "../profiler/profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+CodeWriter::CodeWriter(QIODevice* device, int capacity):
+    _device(device),
+    _buffer(capacity, '\0'),
+    _used(0),
+    _line_start(false),
+    _failed(false),
+    _bytes(0),
+    _lines(0)
+{
+}
+
+CodeWriter::~CodeWriter()
+{
+    flush();
+}
+
+CodeWriter& CodeWriter::operator<<(const QString& text)
+{
+    QByteArray data = text.toUtf8();
+    write(data.constData(), data.size());
+    return *this;
+}
+
+CodeWriter& CodeWriter::operator<<(const QByteArray& data)
+{
+    write(data.constData(), data.size());
+    return *this;
+}
+
+CodeWriter& CodeWriter::operator<<(const char* text)
+{
+    write(text, int(std::strlen(text)));
+    return *this;
+}
+
+CodeWriter& CodeWriter::operator<<(int value)
+{
+    return *this << QByteArray::number(value);
+}
+
+CodeWriter& CodeWriter::operator<<(qint64 value)
+{
+    return *this << QByteArray::number(value);
+}
+
+CodeWriter& CodeWriter::operator<<(quint64 value)
+{
+    return *this << QByteArray::number(value);
+}
+
+void CodeWriter::setIndent(const QByteArray& indent)
+{
+    _indent = indent;
+}
+
+bool CodeWriter::atLineStart() const
+{
+    return _line_start;
+}
+
+void CodeWriter::flush()
+{
+    if (_device && _used > 0 && !_failed)
+    {
+        ScopedTimer timer("write");
+        _failed = _device->write(_buffer.constData(), _used) != _used;
+    }
+
+    _used = 0;
+}
+
+bool CodeWriter::failed() const
+{
+    return _failed;
+}
+
+qint64 CodeWriter::bytes() const
+{
+    return _bytes;
+}
+
+qint64 CodeWriter::lines() const
+{
+    return _lines;
+}
+
+void CodeWriter::write(const char* data, int size)
+{
+    while (size > 0)
+    {
+        if (_line_start)
+        {
+            append(_indent.constData(), _indent.size());
+            _line_start = false;
+        }
+
+        const char* end = static_cast<const char*>(std::memchr(data, '\n', size_t(size)));
+        int length = end ? int(end - data) + 1 : size;
+
+        append(data, length);
+        _line_start = end != nullptr;
+        data += length;
+        size -= length;
+    }
+}
+
+void CodeWriter::append(const char* data, int size)
+{
+    _lines += std::count(data, data + size, '\n');
+    _bytes += size;
+
+    while (size > 0)
+    {
+        if (_used == _buffer.size())
+        {
+            flush();
+        }
+
+        int length = qMin(size, _buffer.size() - _used);
+        std::memcpy(_buffer.data() + _used, data, size_t(length));
+        _used += length;
+        data += length;
+        size -= length;
+    }
+}
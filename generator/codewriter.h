@@ -0,0 +1,55 @@
+#ifndef CODEWRITER_H
+#define CODEWRITER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+
+// Sends generated code as UTF-8 to a device in chunks of a fixed-size
+// buffer, so memory stays bounded however large the file is. Without a
+// device it only counts what would have been written. A short write to
+// the device marks the writer failed.
+//
+// An indent, when set, is put after every line break, just before the next
+// character, so the last line break of a block can still be followed by
+// unindented text.
+class CodeWriter
+{
+public:
+    CodeWriter(QIODevice*, int capacity = 1 << 16);
+    ~CodeWriter();
+
+    CodeWriter(const CodeWriter&) = delete;
+    CodeWriter& operator=(const CodeWriter&) = delete;
+
+    CodeWriter& operator<<(const QString&);
+    CodeWriter& operator<<(const QByteArray&);
+    CodeWriter& operator<<(const char*);
+    CodeWriter& operator<<(int);
+    CodeWriter& operator<<(qint64);
+    CodeWriter& operator<<(quint64);
+
+    void setIndent(const QByteArray&);
+    bool atLineStart() const;
+    void flush();
+    bool failed() const;
+
+    qint64 bytes() const;
+    qint64 lines() const;
+
+private:
+    void write(const char*, int);
+    void append(const char*, int);
+
+private:
+    QIODevice* _device;
+    QByteArray _buffer;
+    int _used;
+    QByteArray _indent;
+    bool _line_start;
+    bool _failed;
+    qint64 _bytes;
+    qint64 _lines;
+};
+
+#endif // CODEWRITER_H
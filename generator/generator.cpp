@@ -1,8 +1,19 @@
 #include "generator.h"
 
+#include "codewriter.h"
+#include "../analysis/structuralhash.h"
+#include "../profiler/profiler.h"
+
 #include <QFile>
-#include <QTextStream>
+#include <QFileInfo>
+#include <QSaveFile>
 #include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+const int Generator::_version = 11;
+const QString Generator::_manifest_name = QStringLiteral(".lsc-manifest.json");
 
 const QString Generator::_schema_template = QStringLiteral(
     "#pragma once\n"
@@ -16,11 +27,22 @@ const QString Generator::_schema_template = QStringLiteral(
     "   ~%1() {}\n"
     "   virtual void construct() override {\n"
     "       std::shared_ptr<%1> schema = shared_from_this();\n"
-    "       %2\n"
+    "       "
+);
+
+const QString Generator::_schema_end_template = QStringLiteral(
     "   }\n"
     "};\n"
 );
 
+const QString Generator::_alias_template = QStringLiteral(
+    "#pragma once\n"
+    "#include \"single_include.hpp\"\n"
+    "#include \"%2.hpp\"\n"
+    "\n"
+    "using %1 = %2;\n"
+);
+
 const QString Generator::_pro_template = QStringLiteral(
     "QT -= gui\n\n"
     "CONFIG -= app_bundle\n"
@@ -53,12 +75,60 @@ const QString Generator::_main_template = QStringLiteral(
 const QString Generator::_single_include_template = QStringLiteral(
     "#pragma once\n"
     "#include <lib/logic_schemes_lib.hpp>\n"
+    "#include <array>\n"
+    "#include <string>\n"
     "\n"
     "\n"
     "%1\n"
 );
 
-Generator::Generator()
+const QString Generator::_batch_template = QStringLiteral(
+    "%1"
+    "#include \"batch.hpp\"\n"
+    "#include \"netlist.hpp\"\n"
+    "\n"
+    "int main(int argc, char* argv[])\n"
+    "{\n"
+    "    return lsc::runBatch(design::netlist, argc, argv);\n"
+    "}\n"
+);
+
+const QString Generator::_batch_pro_template = QStringLiteral(
+    "TEMPLATE = app\n"
+    "TARGET = %1_batch\n\n"
+    "CONFIG -= qt app_bundle\n"
+    "CONFIG += c++17 console optimize_full thread\n\n"
+    "HEADERS = simulation.hpp trace.hpp batch.hpp netlist.hpp \n\n"
+    "SOURCES = batch.cpp \n\n"
+    "%2"
+);
+
+const QString Generator::_static_template = QStringLiteral(
+    "struct %1\n"
+    "{\n"
+    "    static constexpr std::size_t input_count = %2;\n"
+    "    static constexpr std::size_t output_count = %3;\n"
+    "\n"
+    "    std::array<uint64_t, lsc::words(%2)> inputs {};\n"
+    "    std::array<uint64_t, lsc::words(%3)> outputs {};\n"
+    "\n"
+    "%4"
+    "\n"
+    "    void evaluate()\n"
+    "    {\n"
+    "%5"
+    "    }\n"
+    "%6"
+    "};\n"
+    "\n"
+);
+
+Generator::Generator():
+    _saved_lines(0),
+    _saved_bytes(0),
+    _written(0),
+    _skipped(0),
+    _removed(0)
 {
 }
 
@@ -68,71 +138,559 @@ Generator::~Generator()
 
 void Generator::generate(const QString& path, const SharedPtr<Schema>& main_schema, const QMap<QString, SharedPtr<Schema>>& schemas)
 {
-    QFile pro(path + "/" + main_schema->typeName().toLower() + ".pro"),
-          main(path + "/main.cpp"),
-          single_include(path + "/single_include.hpp");
+    ScopedTimer timer("generate");
 
-    if (pro.open(QIODevice::WriteOnly))
+    loadManifest(path);
+    generateProject(path, main_schema, schemas);
+    generateSchemas(path, schemas.values());
+    generateSimulation(path, main_schema, schemas);
+
+    if (_options.static_backend)
     {
-        pro.write(generateProFile(schemas));
-        pro.close();
+        generateStaticDesign(path, main_schema, schemas);
     }
-
-    if (main.open(QIODevice::WriteOnly))
+    else
     {
-        main.write(generateMainFile(main_schema));
-        main.close();
+        _memoize_warnings.clear();
     }
 
-    if (single_include.open(QIODevice::WriteOnly))
+    for(const QString& file : _manifest.keys())
     {
-        single_include.write(generateSingleInclude(schemas));
-        single_include.close();
+        if (!_produced.contains(file))
+        {
+            QFile::remove(path + "/" + file);
+            _manifest.remove(file);
+            _removed++;
+        }
     }
 
+    saveManifest(path);
+}
+
+void Generator::generateProject(const QString& path, const SharedPtr<Schema>& main_schema, const QMap<QString, SharedPtr<Schema>>& schemas)
+{
+    quint64 names = StructuralHash::hashString(QStringList(schemas.keys()).join(','));
+
+    writeFile(path + "/" + main_schema->typeName().toLower() + ".pro", StructuralHash::mix(names, StructuralHash::hashString(QDir::currentPath())),
+              [&]() { return generateProFile(schemas); });
+    writeFile(path + "/main.cpp", StructuralHash::hashString(main_schema->typeName()), [&]() { return generateMainFile(main_schema); });
+    writeFile(path + "/single_include.hpp", names, [&]() { return generateSingleInclude(schemas); });
+}
+
+void Generator::generateSchemas(const QString& path, const QList<SharedPtr<Schema>>& schemas)
+{
     for(const SharedPtr<Schema>& schema : schemas)
     {
-        QFile file(path + "/" + schema->typeName() + ".hpp");
+        QString representative = _representatives.value(schema->typeName(), schema->typeName());
+
+        if (representative == schema->typeName())
+        {
+            streamFile(path + "/" + schema->typeName() + ".hpp", schemaKey(schema), [&](CodeWriter& out) { generateSchemaClass(schema, out); });
+        }
+        else
+        {
+            writeFile(path + "/" + schema->typeName() + ".hpp", StructuralHash::mix(schemaKey(schema), StructuralHash::hashString(representative)), [&]()
+            {
+                QByteArray alias = _alias_template.arg(schema->typeName(), representative).toUtf8();
+                CodeWriter full(nullptr);
+
+                generateSchemaClass(schema, full);
+                _saved_lines += full.lines() - alias.count('\n');
+                _saved_bytes += full.bytes() - alias.size();
+                return alias;
+            });
+        }
+    }
+}
+
+void Generator::removeSchemas(const QString& path, const QStringList& type_names)
+{
+    for(const QString& type_name : type_names)
+    {
+        QFile::remove(path + "/" + type_name + ".hpp");
+        _manifest.remove(type_name + ".hpp");
+    }
+}
+
+bool Generator::generateSimulation(const QString& path, const SharedPtr<Schema>& main_schema, const QMap<QString, SharedPtr<Schema>>& schemas)
+{
+    quint64 design = StructuralHash::mix(StructuralHash::mix(designKey(main_schema, schemas), quint64(_options.layout)),
+                                         quint64(_options.lut_size));
+
+    _simulation_error.clear();
+
+    // The mapping summary is kept in the manifest next to netlist.hpp, so
+    // an up-to-date netlist still reports it.
+    if (!upToDate(path + "/netlist.hpp", design))
+    {
+        Netlist netlist(main_schema, schemas);
+        _simulation_error = netlist.error();
+        _mapping_summary.clear();
 
-        if(file.open(QIODevice::WriteOnly))
+        if (!netlist.isValid())
         {
-            QByteArray data = generateSchemaClass(schema);
-            file.write(data);
-            file.close();
+            return false;
+        }
+
+        netlist.relayout(_options.layout);
+
+        // Sequential designs are simulated one cycle at a time, where a
+        // table lookup replaces the gates of a cut.
+        SharedPtr<LutMapper> mapper = _options.lut_size > 0 ? std::make_shared<LutMapper>(netlist, _options.lut_size) : nullptr;
+        int errors = _write_errors.size();
+        streamFile(path + "/netlist.hpp", design, [&](CodeWriter& out) { generateNetlist(netlist, mapper.get(), out); });
+
+        if (mapper && _write_errors.size() == errors)
+        {
+            _mapping_summary = mapper->summary();
         }
     }
+
+    for(const char* runtime : { "simulation.hpp", "trace.hpp", "batch.hpp" })
+    {
+        writeRuntime(path, runtime);
+    }
+
+    writeFile(path + "/batch.cpp", _options.toggle_coverage ? 1 : 0, [&]()
+    {
+        return _batch_template.arg(_options.toggle_coverage ? "#define LSC_TOGGLE_COVERAGE\n" : "").toUtf8();
+    });
+
+    // Toggle counting is mostly popcounts, which x86 otherwise does in software.
+    QString popcount = _options.toggle_coverage ? "!msvc:contains(QT_ARCH, x86_64): QMAKE_CXXFLAGS += -mpopcnt\n" : "";
+
+    writeFile(path + "/" + main_schema->typeName().toLower() + "_batch.pro",
+              StructuralHash::mix(StructuralHash::hashString(main_schema->typeName()), _options.toggle_coverage ? 1 : 0),
+              [&]() { return _batch_pro_template.arg(main_schema->typeName().toLower(), popcount).toUtf8(); });
+    return true;
+}
+
+const QString& Generator::simulationError() const
+{
+    return _simulation_error;
+}
+
+const QString& Generator::mappingSummary() const
+{
+    return _mapping_summary;
 }
 
-QByteArray Generator::generateSchemaClass(const SharedPtr<Schema>& schema)
+void Generator::generateStaticDesign(const QString& path, const SharedPtr<Schema>& main_schema, const QMap<QString, SharedPtr<Schema>>& schemas)
 {
-    QString string;
-    QTextStream stream(&string);
+    quint64 design = designKey(main_schema, schemas);
+
+    for(auto it = _representatives.constBegin(); it != _representatives.constEnd(); ++it)
+    {
+        design = StructuralHash::mix(design, StructuralHash::hashString(it.key() + "=" + it.value()));
+    }
+
+    design = StructuralHash::mix(design, StructuralHash::hashString(_options.memoize.join(',')));
+
+    writeRuntime(path, "static.hpp");
+    writeFile(path + "/static_design.hpp", design, [&]()
+    {
+        QByteArray data = "#pragma once\n#include \"static.hpp\"\n\nnamespace static_design {\n\n";
+        QSet<QString> emitted;
+        _clocked.clear();
+        _not_memoized.clear();
+
+        std::function<void(const QString&)> emit_class = [&](const QString& type_name)
+        {
+            if (emitted.contains(type_name) || !schemas.contains(type_name))
+            {
+                return;
+            }
+
+            emitted.insert(type_name);
+            SharedPtr<Schema> schema = schemas.value(type_name);
+            QString representative = _representatives.value(type_name, type_name);
+
+            if (representative != type_name)
+            {
+                emit_class(representative);
+                data += ("using " + type_name + " = " + representative + ";\n\n").toUtf8();
+
+                if (_clocked.contains(representative))
+                {
+                    _clocked.insert(type_name);
+                }
+
+                return;
+            }
+
+            for(const SharedPtr<Block>& block : schema->blocks())
+            {
+                if (block->type() == BlockType::CUSTOM)
+                {
+                    emit_class(block->typeName());
+                }
+            }
+
+            data += generateStaticClass(schema);
+        };
+
+        emit_class(main_schema->typeName());
+        data += "}\n";
+
+        // Like the mapping summary, the warnings are kept in the manifest, so
+        // an up-to-date static_design.hpp still reports them.
+        _memoize_warnings.clear();
+
+        for(const QString& name : _options.memoize)
+        {
+            QString representative = _representatives.value(name, name);
+
+            if (name == "*")
+            {
+                for(auto it = _not_memoized.constBegin(); it != _not_memoized.constEnd(); ++it)
+                {
+                    _memoize_warnings.append(QString("Warning: schema \"%1\" is not memoized: %2").arg(it.key(), it.value()));
+                }
+            }
+            else if (!schemas.contains(name))
+            {
+                _memoize_warnings.append(QString("Warning: schema \"%1\" given to --memoize is not part of the design").arg(name));
+            }
+            else if (_not_memoized.contains(representative))
+            {
+                _memoize_warnings.append(QString("Warning: schema \"%1\" is not memoized: %2").arg(name, _not_memoized.value(representative)));
+            }
+        }
+
+        _memoize_warnings.removeDuplicates();
+        return data;
+    });
+}
+
+const QStringList& Generator::memoizeWarnings() const
+{
+    return _memoize_warnings;
+}
+
+void Generator::setOptions(const GeneratorOptions& options)
+{
+    _options = options;
+}
+
+const GeneratorOptions& Generator::options() const
+{
+    return _options;
+}
+
+void Generator::setRepresentatives(const QMap<QString, QString>& representatives)
+{
+    _representatives = representatives;
+}
+
+int Generator::savedLines() const
+{
+    return _saved_lines;
+}
+
+qint64 Generator::savedBytes() const
+{
+    return _saved_bytes;
+}
+
+bool Generator::loadManifest(const QString& path)
+{
+    QFile file(path + "/" + _manifest_name);
+    QJsonObject object;
+
+    _manifest.clear();
+    _produced.clear();
+    _written = 0;
+    _skipped = 0;
+    _removed = 0;
+    _write_errors.clear();
+    _mapping_summary.clear();
+    _memoize_warnings.clear();
+
+    if (file.open(QIODevice::ReadOnly))
+    {
+        object = QJsonDocument::fromJson(file.readAll()).object();
+    }
+
+    if (object.value("version").toInt() != _version)
+    {
+        return false;
+    }
+
+    QJsonObject files = object.value("files").toObject();
+
+    for(auto it = files.constBegin(); it != files.constEnd(); ++it)
+    {
+        _manifest.insert(it.key(), it.value().toString().toULongLong(nullptr, 16));
+    }
+
+    _mapping_summary = object.value("mapping_summary").toString();
+
+    for(const QJsonValue& warning : object.value("memoize_warnings").toArray())
+    {
+        _memoize_warnings.append(warning.toString());
+    }
+
+    return true;
+}
+
+void Generator::saveManifest(const QString& path) const
+{
+    QJsonObject files;
+
+    for(auto it = _manifest.constBegin(); it != _manifest.constEnd(); ++it)
+    {
+        files.insert(it.key(), QString::number(it.value(), 16));
+    }
+
+    QFile file(path + "/" + _manifest_name);
+
+    if (file.open(QIODevice::WriteOnly))
+    {
+        QJsonObject manifest { { "version", _version }, { "files", files } };
+
+        if (_manifest.contains("netlist.hpp") && !_mapping_summary.isEmpty())
+        {
+            manifest.insert("mapping_summary", _mapping_summary);
+        }
+
+        if (_manifest.contains("static_design.hpp") && !_memoize_warnings.isEmpty())
+        {
+            manifest.insert("memoize_warnings", QJsonArray::fromStringList(_memoize_warnings));
+        }
+
+        file.write(QJsonDocument(manifest).toJson());
+    }
+}
+
+int Generator::writtenFiles() const
+{
+    return _written;
+}
+
+int Generator::skippedFiles() const
+{
+    return _skipped;
+}
+
+int Generator::removedFiles() const
+{
+    return _removed;
+}
+
+QStringList Generator::takeWriteErrors()
+{
+    QStringList errors = _write_errors;
+    _write_errors.clear();
+    return errors;
+}
+
+bool Generator::upToDate(const QString& path, quint64 key)
+{
+    QString name = QFileInfo(path).fileName();
+
+    if (_manifest.contains(name) && _manifest.value(name) == key && QFile::exists(path))
+    {
+        _produced.insert(name);
+        _skipped++;
+        return true;
+    }
+
+    return false;
+}
+
+// Hashes everything a schema header is generated from. Unlike the
+// structural hash, names and IDs count.
+quint64 Generator::schemaKey(const SharedPtr<Schema>& schema) const
+{
+    quint64 key = StructuralHash::hashString(schema->typeName());
+
+    for(const QPair<ID, QString>& input : schema->inputs())
+    {
+        key = StructuralHash::mix(StructuralHash::mix(key, input.first), StructuralHash::hashString(input.second));
+    }
+
+    key = StructuralHash::mix(key, schema->inputs().size());
+
+    for(const QPair<ID, QString>& output : schema->outputs())
+    {
+        key = StructuralHash::mix(StructuralHash::mix(key, output.first), StructuralHash::hashString(output.second));
+    }
+
+    for(auto it = schema->blocks().constBegin(); it != schema->blocks().constEnd(); ++it)
+    {
+        key = StructuralHash::mix(StructuralHash::mix(key, it.key()), StructuralHash::hashString(it.value()->typeName()));
+        key = StructuralHash::mix(key, StructuralHash::hashString(it.value()->inputs().join(',') + "|" + it.value()->outputs().join(',')));
+
+        for(int port = 0; port < it.value()->inputs().size(); port++)
+        {
+            key = StructuralHash::mix(key, it.value()->inputWidth(port));
+        }
+
+        for(int port = 0; port < it.value()->outputs().size(); port++)
+        {
+            key = StructuralHash::mix(key, it.value()->outputWidth(port));
+        }
+    }
+
+    for(const SharedPtr<Connection>& connection : schema->connections())
+    {
+        key = StructuralHash::mix(StructuralHash::mix(key, connection->inputID()), StructuralHash::hashString(connection->inputName()));
+        key = StructuralHash::mix(StructuralHash::mix(key, connection->outputID()), StructuralHash::hashString(connection->outputName()));
+        key = StructuralHash::mix(StructuralHash::mix(key, connection->inputLsb()), connection->inputWidth());
+        key = StructuralHash::mix(key, connection->outputLsb());
+    }
+
+    return key;
+}
+
+quint64 Generator::designKey(const SharedPtr<Schema>& main_schema, const QMap<QString, SharedPtr<Schema>>& schemas) const
+{
+    quint64 key = StructuralHash::hashString(main_schema->typeName());
+
+    for(const SharedPtr<Schema>& schema : schemas)
+    {
+        key = StructuralHash::mix(key, schemaKey(schema));
+    }
+
+    return key;
+}
+
+void Generator::writeFile(const QString& path, quint64 key, const std::function<QByteArray()>& content)
+{
+    streamFile(path, key, [&](CodeWriter& out) { out << content(); });
+}
+
+// The file is written while it is generated, one buffer at a time, so
+// "write" is timed inside "emit". It replaces the previous file only once
+// it is complete; if writing fails the previous file stays, and so does its
+// old key, so the next run tries again.
+void Generator::streamFile(const QString& path, quint64 key, const std::function<void(CodeWriter&)>& content)
+{
+    if (upToDate(path, key))
+    {
+        return;
+    }
+
+    QString name = QFileInfo(path).fileName();
+    QSaveFile file(path);
+    bool written = file.open(QIODevice::WriteOnly);
+    qint64 bytes = 0;
+
+    _produced.insert(name);
+
+    if (written)
+    {
+        ScopedTimer timer("emit");
+        CodeWriter out(&file);
+        content(out);
+        out.flush();
+        bytes = out.bytes();
+        written = !out.failed();
+    }
+
+    if (!written || !file.commit())
+    {
+        _write_errors.append(QString("Cannot write \"%1\": %2").arg(path, file.errorString()));
+        return;
+    }
+
+    _manifest.insert(name, key);
+    _written++;
+
+    Profiler::instance().add(Counter::FILES_WRITTEN, 1);
+    Profiler::instance().add(Counter::BYTES_WRITTEN, bytes);
+}
+
+void Generator::generateSchemaClass(const SharedPtr<Schema>& schema, CodeWriter& stream)
+{
+    stream << _schema_template.arg(schema->typeName());
+    stream.setIndent("       ");
+
+    // The library has single-bit pins only. A bus primitive becomes an array
+    // of blocks, one per bit, and a custom block numbers the bits of its
+    // ports consecutively. Bus connections and IO are emitted as loops.
+    auto pin = [&](ID id, bool input, int port, int lsb, bool loop)
+    {
+        SharedPtr<Block> block = schema->blocks()[id];
+        QString name = block->typeName() + QString::number(id);
+        QString method = input ? "->input(" : "->output(";
+        QString bit = loop ? (lsb == 0 ? QString("bit") : "bit + " + QString::number(lsb)) : QString::number(lsb);
+
+        if (block->type() == BlockType::CUSTOM)
+        {
+            int offset = lsb;
+
+            for(int i = 0; i < port; i++)
+            {
+                offset += input ? block->inputWidth(i) : block->outputWidth(i);
+            }
+
+            return name + method + (loop ? (offset == 0 ? QString("bit") : "bit + " + QString::number(offset)) : QString::number(offset)) + ")";
+        }
+
+        return (block->outputWidth(0) == 1 ? name : name + "[" + bit + "]") + method + QString::number(port) + ")";
+    };
+
+    auto repeat = [&](int width, const std::function<QString(bool)>& statement)
+    {
+        if (width == 1)
+        {
+            stream << statement(false) << ";\n";
+        }
+        else
+        {
+            stream << "for(int bit = 0; bit < " << width << "; bit++) " << statement(true) << ";\n";
+        }
+    };
 
     for(const ID& id : schema->blocks().keys())
     {
         SharedPtr<Block> block = schema->blocks()[id];
         QString name = block->typeName() + QString::number(id);
+        int width = block->type() == BlockType::CUSTOM ? 1 : block->outputWidth(0);
+
+        if (width == 1)
+        {
+            stream << "std::shared_ptr<" << block->typeName() << "> " << name
+                   << " = schema->add<" << block->typeName() << ">();\n";
+
+            stream << name << "->setId(" << QString::number(id) << ");\n";
+        }
+        else
+        {
+            stream << "std::array<std::shared_ptr<" << block->typeName() << ">, " << width << "> " << name << ";\n"
+                   << "for(int bit = 0; bit < " << width << "; bit++) {\n"
+                   << "    " << name << "[bit] = schema->add<" << block->typeName() << ">();\n"
+                   << "    " << name << "[bit]->setId(" << QString::number(id) << ");\n";
+
+            for(const QString& input : block->inputs())
+            {
+                stream << "    " << name << "[bit]->addInput(\"" << input << "[\" + std::to_string(bit) + \"]\");\n";
+            }
 
-        stream << "std::shared_ptr<" << block->typeName() << "> " << name
-               << " = schema->add<" << block->typeName() << ">();";
+            for(const QString& output : block->outputs())
+            {
+                stream << "    " << name << "[bit]->addOutput(\"" << output << "[\" + std::to_string(bit) + \"]\");\n";
+            }
 
-        stream << name << "->setId(" << QString::number(id) << ");";
+            stream << "}\n";
+        }
 
-        if (block->type() != BlockType::CUSTOM)
+        if (block->type() != BlockType::CUSTOM && width == 1)
         {
             for(const QString& input : block->inputs())
             {
-                stream << name << "->addInput(\"" << input << "\");";
+                stream << name << "->addInput(\"" << input << "\");\n";
             }
 
             for(const QString& output : block->outputs())
             {
-                stream << name << "->addOutput(\"" << output << "\");";
+                stream << name << "->addOutput(\"" << output << "\");\n";
             }
         }
-        else
+        else if (block->type() == BlockType::CUSTOM)
         {
-            stream << name << "->construct();";
+            stream << name << "->construct();\n";
         }
     }
 
@@ -140,34 +698,34 @@ QByteArray Generator::generateSchemaClass(const SharedPtr<Schema>& schema)
     {
         SharedPtr<Block> input_block = schema->blocks()[connection->inputID()];
         SharedPtr<Block> output_block = schema->blocks()[connection->outputID()];
-        QString input  = input_block->typeName() + QString::number(connection->inputID());
-        QString output = output_block->typeName() + QString::number(connection->outputID());
+        int input_port = input_block->inputs().indexOf(connection->inputName());
+        int output_port = output_block->outputs().indexOf(connection->outputName());
 
-        stream << "schema->connect(" << output << "->output(" << output_block->outputs().indexOf(connection->outputName()) << ")" << ","
-                                    << input << "->input(" << input_block->inputs().indexOf(connection->inputName()) << ")" << ");";
+        repeat(connection->inputWidth(), [&](bool loop)
+        {
+            return "schema->connect(" + pin(connection->outputID(), false, output_port, connection->outputLsb(), loop) + ","
+                                      + pin(connection->inputID(), true, input_port, connection->inputLsb(), loop) + ")";
+        });
     }
 
-    for(const QPair<ID, QString>& p  : schema->inputs())
+    for(int i = 0; i < schema->inputs().size(); i++)
     {
-        ID id = p.first;
-        QString name = p.second;
-        SharedPtr<Block> input_block = schema->blocks()[id];
-        QString input  = input_block->typeName() + QString::number(id);
+        ID id = schema->inputs()[i].first;
+        int port = schema->blocks()[id]->inputs().indexOf(schema->inputs()[i].second);
 
-        stream << "schema->_inputs.push_back(" << input << "->input(" << input_block->inputs().indexOf(name) << "));";
+        repeat(schema->inputWidths().value(i, 1), [&](bool loop) { return "schema->_inputs.push_back(" + pin(id, true, port, 0, loop) + ")"; });
     }
 
-    for(const QPair<ID, QString>& p  : schema->outputs())
+    for(int i = 0; i < schema->outputs().size(); i++)
     {
-        ID id = p.first;
-        QString name = p.second;
-        SharedPtr<Block> output_block = schema->blocks()[id];
-        QString output  = output_block->typeName() + QString::number(id);
+        ID id = schema->outputs()[i].first;
+        int port = schema->blocks()[id]->outputs().indexOf(schema->outputs()[i].second);
 
-        stream << "schema->_outputs.push_back(" << output << "->output(" << output_block->outputs().indexOf(name) << "));";
+        repeat(schema->outputWidths().value(i, 1), [&](bool loop) { return "schema->_outputs.push_back(" + pin(id, false, port, 0, loop) + ")"; });
     }
 
-    return _schema_template.arg(schema->typeName(), string).toUtf8();
+    stream.setIndent(QByteArray());
+    stream << (stream.atLineStart() ? "" : "\n") << _schema_end_template;
 }
 
 QByteArray Generator::generateProFile(const QMap<QString, SharedPtr<Schema>>& schemas)
@@ -200,3 +758,294 @@ QByteArray Generator::generateSingleInclude(const QMap<QString, SharedPtr<Schema
 
     return _single_include_template.arg(includes).toUtf8();
 }
+
+void Generator::generateNetlist(const Netlist& netlist, const LutMapper* mapper, CodeWriter& stream)
+{
+    auto array = [&](const char* type, const char* name, int size, const std::function<QString(int)>& value)
+    {
+        stream << "static const " << type << " " << name << "[] = {";
+
+        for(int i = 0; i < size; i++)
+        {
+            stream << (i % 16 == 0 ? "\n    " : " ") << value(i) << (i + 1 < size ? "," : "");
+        }
+
+        stream << (size == 0 ? " 0 };\n\n" : "\n};\n\n");
+    };
+
+    auto literal = [](QString name)
+    {
+        return "\"" + name.replace("\\", "\\\\").replace("\"", "\\\"") + "\"";
+    };
+
+    stream << "#pragma once\n"
+           << "#include \"simulation.hpp\"\n\n"
+           << "namespace design {\n\n";
+
+    QVector<int> offsets(1, 0), fanin;
+
+    for(int gate = 0; gate < netlist.gateCount(); gate++)
+    {
+        for(int i = 0; i < netlist.faninCount(gate); i++)
+        {
+            fanin.append(netlist.fanin(gate)[i]);
+        }
+
+        offsets.append(fanin.size());
+    }
+
+    array("uint8_t", "kinds", netlist.gateCount(), [&](int i) { return QString::number(int(netlist.kind(i))); });
+    array("uint32_t", "offsets", offsets.size(), [&](int i) { return QString::number(offsets[i]); });
+    array("uint32_t", "fanin", fanin.size(), [&](int i) { return QString::number(fanin[i]); });
+    array("uint32_t", "output_nets", netlist.outputCount(), [&](int i) { return QString::number(netlist.outputNet(i)); });
+    array("char* const", "input_names", netlist.inputCount(), [&](int i) { return literal(netlist.inputName(i)); });
+    array("char* const", "output_names", netlist.outputCount(), [&](int i) { return literal(netlist.outputName(i)); });
+    array("char* const", "scope_names", netlist.scopes().size(), [&](int i) { return literal(netlist.scopeName(i)); });
+    array("int32_t", "scope_parents", netlist.scopes().size(), [&](int i) { return QString::number(netlist.scopeParent(i)); });
+    array("uint32_t", "gate_scopes", netlist.gateCount(), [&](int i) { return QString::number(netlist.scope(i)); });
+    array("uint64_t", "gate_ids", netlist.gateCount(), [&](int i) { return QString::number(netlist.blockId(i)); });
+
+    QVector<Lut> luts = mapper ? mapper->luts() : QVector<Lut>();
+    QVector<int> lut_offsets(1, 0), lut_leaves;
+
+    for(const Lut& lut : luts)
+    {
+        lut_leaves.append(lut.leaves);
+        lut_offsets.append(lut_leaves.size());
+    }
+
+    array("uint32_t", "lut_offsets", lut_offsets.size(), [&](int i) { return QString::number(lut_offsets[i]); });
+    array("uint32_t", "lut_leaves", lut_leaves.size(), [&](int i) { return QString::number(lut_leaves[i]); });
+    array("uint32_t", "lut_nets", luts.size(), [&](int i) { return QString::number(luts[i].net); });
+    array("uint64_t", "lut_tables", luts.size(), [&](int i) { return "0x" + QString::number(luts[i].table, 16) + "ull"; });
+
+    stream << "static const lsc::Netlist netlist = {\n"
+           << "    " << netlist.inputCount() << ", " << netlist.outputCount() << ", " << netlist.gateCount() << ",\n"
+           << "    kinds, offsets, fanin, output_nets, input_names, output_names,\n"
+           << "    " << netlist.scopes().size() << ", scope_names, scope_parents, gate_scopes, gate_ids,\n"
+           << "    0x" << QString::number(netlist.hash(), 16) << "ull,\n"
+           << "    " << luts.size() << ", " << (mapper ? mapper->scratchNets() : 0) << ", lut_offsets, lut_leaves, lut_nets, lut_tables\n"
+           << "};\n\n"
+           << "}\n";
+}
+
+QByteArray Generator::generateStaticClass(const SharedPtr<Schema>& schema)
+{
+    const NetGraph& graph = schema->graph();
+    QStringList names;
+    QString members, body;
+    QVector<int> global(graph.inputPinCount(), -1);
+    QVector<int> pending(graph.blockCount(), 0);
+    QVector<int> order, clocked;
+    QVector<bool> registers(graph.blockCount(), false);
+
+    for(int block = 0; block < graph.blockCount(); block++)
+    {
+        SharedPtr<Block> b = schema->blocks().value(graph.id(block));
+        QString width = QString::number(b->outputWidth(0));
+        QString type = b->type() == BlockType::CUSTOM ? b->typeName()
+                     : b->type() != BlockType::MULTIPHASE ? "lsc::" + b->typeName() + "<" + width + ">"
+                     : b->outputWidth(0) == 1 ? "lsc::" + b->typeName() + "<" + QString::number(b->inputs().size()) + ">"
+                     : "lsc::" + b->typeName() + "<" + QString::number(b->inputs().size()) + ", " + width + ">";
+
+        names.append(b->typeName() + "_" + QString::number(graph.id(block)));
+        members += "    " + type + " " + names.last() + ";\n";
+
+        if (b->type() == BlockType::SEQUENTIAL || (b->type() == BlockType::CUSTOM && _clocked.contains(b->typeName())))
+        {
+            clocked.append(block);
+        }
+
+        registers[block] = b->type() == BlockType::SEQUENTIAL;
+    }
+
+    for(int i = 0; i < graph.globalInputs().size(); i++)
+    {
+        global[graph.globalInputs()[i]] = i;
+    }
+
+    for(int pin = 0; pin < graph.inputPinCount(); pin++)
+    {
+        pending[graph.inputBlock(pin)] += graph.driver(pin) != -1 && !registers[graph.inputBlock(pin)] ? 1 : 0;
+    }
+
+    for(int block = 0; block < graph.blockCount(); block++)
+    {
+        if (pending[block] == 0)
+        {
+            order.append(block);
+        }
+    }
+
+    for(int head = 0; head < order.size(); head++)
+    {
+        int block = order[head];
+        int first = graph.outputPinCount(block) > 0 ? graph.outputPin(block, 0) : 0;
+
+        for(int pin = first; pin < first + graph.outputPinCount(block); pin++)
+        {
+            for(int i = 0; i < graph.fanoutCount(pin); i++)
+            {
+                int sink = graph.inputBlock(graph.fanout(pin)[i]);
+
+                if (!registers[sink] && --pending[sink] == 0)
+                {
+                    order.append(sink);
+                }
+            }
+        }
+    }
+
+    bool cyclic = order.size() != graph.blockCount();
+    QString indent = cyclic ? "            " : "        ";
+
+    for(int block = 0; cyclic && block < graph.blockCount(); block++)
+    {
+        if (pending[block] > 0)
+        {
+            order.append(block);
+        }
+    }
+
+    auto source = [&](int pin)
+    {
+        int driver = graph.driver(pin);
+        return global[pin] != -1 ? qMakePair(-1, global[pin])
+             : driver != -1 ? qMakePair(graph.outputBlock(driver), graph.outputIndex(driver))
+             : qMakePair(-2, 0);
+    };
+
+    // Each 64-bit word of a port array is assembled in one assignment from
+    // the fields that drive it. Consecutive bits from consecutive bits of one
+    // source, as with a bus connection, form a single field. Undriven bits
+    // are left out, so they stay zero.
+    auto assign = [&](const QString& target, int count, const std::function<QPair<int, int>(int)>& source_of)
+    {
+        QString code;
+        QStringList fields;
+
+        for(int index = 0; index < count; )
+        {
+            QPair<int, int> from = source_of(index);
+            int bits = 1;
+
+            while (index + bits < count && (index + bits) % 64 != 0 && source_of(index + bits) == qMakePair(from.first, from.second + bits))
+            {
+                bits++;
+            }
+
+            if (from.first != -2)
+            {
+                fields.append(QString("lsc::extract<%1, %2>(%3)").arg(from.second).arg(bits).arg(from.first == -1 ? QString("inputs") : names[from.first] + ".outputs")
+                              + (index % 64 != 0 ? " << " + QString::number(index % 64) : QString()));
+            }
+
+            index += bits;
+
+            if ((index % 64 == 0 || index == count) && !fields.isEmpty())
+            {
+                code += indent + target + "[" + QString::number((index - 1) / 64) + "] = " + fields.join(" | ") + ";\n";
+                fields.clear();
+            }
+        }
+
+        return code;
+    };
+
+    // Registers drive their outputs from the state of the last clock() and
+    // are evaluated first; their inputs are assigned after all other blocks.
+    QString latch;
+
+    for(int block : order)
+    {
+        int first = graph.inputPinCount(block) > 0 ? graph.inputPin(block, 0) : 0;
+
+        (registers[block] ? latch : body) += assign(names[block] + ".inputs", graph.inputPinCount(block), [&](int index) { return source(first + index); });
+        body += indent + names[block] + ".evaluate();\n";
+    }
+
+    body += latch;
+
+    if (cyclic)
+    {
+        body = "        for(std::size_t pass = 0; pass < " + QString::number(graph.blockCount()) + "; pass++)\n"
+               "        {\n" + body + "        }\n\n";
+    }
+
+    const QVector<int>& global_outputs = graph.globalOutputs();
+
+    indent = "        ";
+    body += assign("outputs", global_outputs.size(), [&](int i)
+    {
+        return qMakePair(graph.outputBlock(global_outputs[i]), graph.outputIndex(global_outputs[i]));
+    });
+
+    int inputs = graph.globalInputs().size();
+    int outputs = graph.globalOutputs().size();
+    QString compute;
+
+    QString rejected = cyclic ? "its blocks form a loop"
+                     : !clocked.isEmpty() ? "it has registers"
+                     : inputs == 0 ? "it has no inputs"
+                     : inputs > 64 || outputs > 64 ? "it has more than 64 inputs or outputs"
+                     : QString();
+
+    if (!rejected.isEmpty() && memoized(schema->typeName()))
+    {
+        _not_memoized.insert(schema->typeName(), rejected);
+    }
+    else if (memoized(schema->typeName()))
+    {
+        compute = "\n    void compute()\n    {\n" + body + "    }\n";
+        body = QString("        lsc::%1<%2>::evaluate(*this, \"%2\");\n").arg(inputs <= 16 ? "TruthTable" : "ResultCache", schema->typeName());
+    }
+
+    // A schema with registers, directly or in its blocks, latches all of
+    // them in clock().
+    if (!clocked.isEmpty())
+    {
+        compute += "\n    void clock()\n    {\n";
+
+        for(int block : clocked)
+        {
+            compute += "        " + names[block] + ".clock();\n";
+        }
+
+        compute += "    }\n";
+        _clocked.insert(schema->typeName());
+    }
+
+    return _static_template.arg(schema->typeName(),
+                                QString::number(inputs),
+                                QString::number(outputs),
+                                members,
+                                body,
+                                compute).toUtf8();
+}
+
+bool Generator::memoized(const QString& type_name) const
+{
+    for(const QString& name : _options.memoize)
+    {
+        if (name == "*" || _representatives.value(name, name) == type_name)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QByteArray Generator::readRuntime(const QString& name)
+{
+    QFile file(":/runtime/" + name);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+// Runtime headers are keyed on their own contents, so a changed runtime is
+// written again without a bump of the generator version.
+void Generator::writeRuntime(const QString& path, const QString& name)
+{
+    QByteArray runtime = readRuntime(name);
+    writeFile(path + "/" + name, StructuralHash::hashString(QString::fromUtf8(runtime)), [&]() { return runtime; });
+}
@@ -2,26 +2,98 @@
 #define GENERATOR_H
 
 #include "../general/schema.h"
+#include "../mapping/lutmapper.h"
+#include "../netlist/netlist.h"
+
+#include <functional>
+
+class CodeWriter;
+
+struct GeneratorOptions
+{
+    bool dedup = true;
+    bool static_backend = false;
+    QStringList memoize;
+    bool toggle_coverage = false;
+    NetLayout layout = NetLayout::DFS;
+    int lut_size = 0;
+};
 
 class Generator
 {
 private:
+    static const int _version;
+    static const QString _manifest_name;
     static const QString _schema_template;
+    static const QString _schema_end_template;
+    static const QString _alias_template;
     static const QString _pro_template;
     static const QString _main_template;
     static const QString _single_include_template;
+    static const QString _batch_template;
+    static const QString _batch_pro_template;
+    static const QString _static_template;
 
 public:
     Generator();
     ~Generator();
 
     void generate(const QString&, const SharedPtr<Schema>&, const QMap<QString, SharedPtr<Schema>>&);
+    void generateProject(const QString&, const SharedPtr<Schema>&, const QMap<QString, SharedPtr<Schema>>&);
+    void generateSchemas(const QString&, const QList<SharedPtr<Schema>>&);
+    void removeSchemas(const QString&, const QStringList&);
+    bool generateSimulation(const QString&, const SharedPtr<Schema>&, const QMap<QString, SharedPtr<Schema>>&);
+    const QString& simulationError() const;
+    const QString& mappingSummary() const;
+    const QStringList& memoizeWarnings() const;
+    void generateStaticDesign(const QString&, const SharedPtr<Schema>&, const QMap<QString, SharedPtr<Schema>>&);
+
+    void setOptions(const GeneratorOptions&);
+    const GeneratorOptions& options() const;
+    void setRepresentatives(const QMap<QString, QString>&);
+    int savedLines() const;
+    qint64 savedBytes() const;
+
+    bool loadManifest(const QString&);
+    void saveManifest(const QString&) const;
+    int writtenFiles() const;
+    int skippedFiles() const;
+    int removedFiles() const;
+    QStringList takeWriteErrors();
 
 private:
-    QByteArray generateSchemaClass(const SharedPtr<Schema>&);
+    bool upToDate(const QString&, quint64);
+    void writeFile(const QString&, quint64, const std::function<QByteArray()>&);
+    void streamFile(const QString&, quint64, const std::function<void(CodeWriter&)>&);
+    quint64 schemaKey(const SharedPtr<Schema>&) const;
+    quint64 designKey(const SharedPtr<Schema>&, const QMap<QString, SharedPtr<Schema>>&) const;
+
+    void generateSchemaClass(const SharedPtr<Schema>&, CodeWriter&);
     QByteArray generateProFile(const QMap<QString, SharedPtr<Schema>>&);
     QByteArray generateMainFile(const SharedPtr<Schema>&);
     QByteArray generateSingleInclude(const QMap<QString, SharedPtr<Schema>>&);
+    void generateNetlist(const Netlist&, const LutMapper*, CodeWriter&);
+    QByteArray generateStaticClass(const SharedPtr<Schema>&);
+    bool memoized(const QString&) const;
+    QByteArray readRuntime(const QString&);
+    void writeRuntime(const QString&, const QString&);
+
+private:
+    GeneratorOptions _options;
+    QMap<QString, QString> _representatives;
+    int _saved_lines;
+    qint64 _saved_bytes;
+    QString _simulation_error;
+    QString _mapping_summary;
+    QStringList _memoize_warnings;
+    QMap<QString, QString> _not_memoized;
+    QMap<QString, quint64> _manifest;
+    QSet<QString> _produced;
+    QSet<QString> _clocked;
+    int _written;
+    int _skipped;
+    int _removed;
+    QStringList _write_errors;
 };
 
 #endif // GENERATOR_H
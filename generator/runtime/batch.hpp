@@ -0,0 +1,547 @@
+#pragma once
+
+#include "simulation.hpp"
+#include "trace.hpp"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/wait.h>
+#endif
+
+namespace lsc {
+
+inline bool endsWith(const std::string& string, const char* suffix)
+{
+    size_t n = std::strlen(suffix);
+    return string.size() >= n && string.compare(string.size() - n, n, suffix) == 0;
+}
+
+// Size of one vector's outputs: a CSV line or a packed binary record.
+inline size_t recordSize(const Netlist& netlist, bool binary)
+{
+    return binary ? (netlist.outputs + 7) / 8 : netlist.outputs ? size_t(netlist.outputs) * 2 : 1;
+}
+
+inline void formatRecord(const Simulator& simulator, uint32_t vector, bool binary, char* out)
+{
+    const uint32_t outputs = simulator.netlist().outputs;
+
+    if (binary)
+    {
+        std::memset(out, 0, (outputs + 7) / 8);
+        for(uint32_t o = 0; o < outputs; o++) out[o / 8] |= char(simulator.outputBit(o, vector) << (o % 8));
+        return;
+    }
+
+    for(uint32_t o = 0; o < outputs; o++)
+    {
+        out[2 * o] = simulator.outputBit(o, vector) ? '1' : '0';
+        out[2 * o + 1] = o + 1 < outputs ? ',' : '\n';
+    }
+
+    if (outputs == 0) out[0] = '\n';
+}
+
+inline std::string csvHeader(const Netlist& netlist)
+{
+    std::string header;
+
+    for(uint32_t o = 0; o < netlist.outputs; o++)
+    {
+        if (o) header += ',';
+        header += netlist.output_names[o];
+    }
+
+    return header + '\n';
+}
+
+#ifndef _WIN32
+// A slice of the stimulus for one worker process. Slices hold whole lines
+// or records, and `first` is the index of their first vector in the run.
+struct Shard
+{
+    const char* begin;
+    const char* end;
+    uint64_t first;
+    uint64_t vectors;
+    size_t line;
+};
+
+// Written by each worker into memory shared with the driver.
+struct ShardResult
+{
+    uint64_t vectors;
+    double seconds;
+    int32_t status;
+    char error[244];
+};
+
+inline uint64_t countVectors(const char* begin, const char* end, size_t* lines)
+{
+    uint64_t vectors = 0;
+
+    while (begin < end)
+    {
+        const char* eol = static_cast<const char*>(std::memchr(begin, '\n', size_t(end - begin)));
+        eol = eol ? eol : end;
+        vectors += StimulusReader::isVector(begin, eol) ? 1 : 0;
+        (*lines)++;
+        begin = eol < end ? eol + 1 : end;
+    }
+
+    return vectors;
+}
+
+inline std::vector<Shard> splitStimulus(const MappedFile& file, uint32_t inputs, bool csv, uint32_t processes)
+{
+    std::vector<Shard> shards;
+    const char* data = file.data();
+    const size_t size = file.size();
+    const size_t stride = (inputs + 7) / 8;
+
+    if (!csv)
+    {
+        const uint64_t total = stride ? size / stride : 0;
+
+        for(uint32_t k = 0; k < processes; k++)
+        {
+            uint64_t first = total * k / processes, next = total * (k + 1) / processes;
+            shards.push_back({ data + first * stride, data + next * stride, first, next - first, 0 });
+        }
+
+        return shards;
+    }
+
+    const char* begin = data;
+    uint64_t first = 0;
+    size_t line = 0;
+
+    for(uint32_t k = 0; k < processes; k++)
+    {
+        const char* end = data + size;
+
+        if (k + 1 < processes)
+        {
+            end = std::max(begin, data + size * (k + 1) / processes);
+            const char* eol = end < data + size ? static_cast<const char*>(std::memchr(end, '\n', size_t(data + size - end))) : nullptr;
+            end = eol ? eol + 1 : data + size;
+        }
+
+        size_t lines = 0;
+        uint64_t vectors = countVectors(begin, end, &lines);
+        shards.push_back({ begin, end, first, vectors, line });
+        first += vectors;
+        line += lines;
+        begin = end;
+    }
+
+    return shards;
+}
+
+inline int32_t runShard(const Netlist& netlist, const Shard& shard, bool csv, char* out, bool binary, ShardResult& result)
+{
+    auto start = std::chrono::steady_clock::now();
+    Simulator simulator(netlist);
+    StimulusReader reader(shard.begin, shard.end, netlist.inputs, csv, shard.line);
+    const size_t record = recordSize(netlist, binary);
+    uint32_t count;
+
+    while ((count = reader.read(simulator)) > 0)
+    {
+        simulator.run(count);
+
+        for(uint32_t v = 0; v < count && out && result.vectors + v < shard.vectors; v++)
+        {
+            formatRecord(simulator, v, binary, out + (result.vectors + v) * record);
+        }
+
+        result.vectors += count;
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::snprintf(result.error, sizeof(result.error), "%s", reader.error().c_str());
+    return reader.error().empty() ? 0 : 1;
+}
+
+// Forks one worker per shard. Workers read their slice straight from the
+// mapped stimulus and write their outputs into their own region of a
+// shared mapping of the output file (or of anonymous memory for stdout),
+// so the merged file needs no copying and nothing goes through pipes.
+inline int runSharded(const Netlist& netlist, const MappedFile& file, const std::string& stimulus, bool csv,
+                      const std::string& output, bool write, bool binary, uint32_t processes)
+{
+    std::vector<Shard> shards = splitStimulus(file, netlist.inputs, csv, processes);
+    uint64_t total = 0;
+
+    for(const Shard& shard : shards) total += shard.vectors;
+
+    const std::string header = write && !binary ? csvHeader(netlist) : std::string();
+    const size_t size = write ? header.size() + total * recordSize(netlist, binary) : 0;
+    const bool to_stdout = output == "-";
+    int fd = -1;
+    char* mapped = nullptr;
+
+    if (write && !to_stdout)
+    {
+        fd = ::open(output.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+        if (fd < 0 || ::ftruncate(fd, off_t(size)) != 0)
+        {
+            std::fprintf(stderr, "Cannot write \"%s\"\n", output.c_str());
+            if (fd >= 0) ::close(fd);
+            return 1;
+        }
+    }
+
+    if (size > 0)
+    {
+        void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, fd >= 0 ? MAP_SHARED : MAP_SHARED | MAP_ANONYMOUS, fd, 0);
+
+        if (data == MAP_FAILED)
+        {
+            std::fprintf(stderr, "Cannot map \"%s\"\n", output.c_str());
+            if (fd >= 0) ::close(fd);
+            return 1;
+        }
+
+        mapped = static_cast<char*>(data);
+        std::memcpy(mapped, header.data(), header.size());
+    }
+
+    void* shared = ::mmap(nullptr, sizeof(ShardResult) * shards.size(), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (shared == MAP_FAILED)
+    {
+        std::fprintf(stderr, "Cannot allocate shared memory\n");
+        if (mapped) ::munmap(mapped, size);
+        if (fd >= 0) ::close(fd);
+        return 1;
+    }
+
+    ShardResult* results = static_cast<ShardResult*>(shared);
+    std::vector<pid_t> workers;
+    auto start = std::chrono::steady_clock::now();
+    int status = 0;
+
+    std::fflush(nullptr);
+
+    for(size_t k = 0; k < shards.size(); k++)
+    {
+        results[k] = ShardResult();
+        results[k].status = -1;
+        pid_t pid = ::fork();
+
+        if (pid == 0)
+        {
+            char* out = mapped ? mapped + header.size() + shards[k].first * recordSize(netlist, binary) : nullptr;
+            results[k].status = runShard(netlist, shards[k], csv, out, binary, results[k]);
+            ::_exit(results[k].status);
+        }
+
+        if (pid < 0)
+        {
+            std::fprintf(stderr, "Cannot start worker %zu\n", k);
+            status = 1;
+            break;
+        }
+
+        workers.push_back(pid);
+    }
+
+    for(pid_t pid : workers)
+    {
+        int code;
+        while (::waitpid(pid, &code, 0) < 0 && errno == EINTR) {}
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t simulated = 0;
+
+    for(size_t k = 0; k < workers.size(); k++)
+    {
+        const ShardResult& result = results[k];
+        simulated += result.vectors;
+
+        if (result.status != 0)
+        {
+            std::fprintf(stderr, "%s: worker %zu: %s\n", stimulus.c_str(), k, result.status < 0 ? "terminated" : result.error);
+            status = 1;
+        }
+        else
+        {
+            std::fprintf(stderr, "Worker %zu: %llu vector(s) in %.3f s, %.0f vectors/s\n", k, (unsigned long long)result.vectors,
+                         result.seconds, result.seconds > 0 ? result.vectors / result.seconds : 0.0);
+        }
+    }
+
+    std::fprintf(stderr, "%llu vector(s) in %.3f s, %.0f vectors/s on %zu process(es)\n",
+                 (unsigned long long)simulated, seconds, seconds > 0 ? simulated / seconds : 0.0, workers.size());
+
+    if (mapped && to_stdout && status == 0 && (std::fwrite(mapped, 1, size, stdout) != size || std::fflush(stdout) != 0))
+    {
+        std::fprintf(stderr, "Cannot write \"%s\"\n", output.c_str());
+        status = 1;
+    }
+
+    if (mapped) ::munmap(mapped, size);
+    if (fd >= 0) ::close(fd);
+    ::munmap(shared, sizeof(ShardResult) * shards.size());
+    return status;
+}
+#endif
+
+inline int runBatch(const Netlist& netlist, int argc, char* argv[])
+{
+    static const char* const usage =
+        "Usage: %s <stimulus.csv|stimulus.bin> [-o output.csv|output.bin|-] [-n]\n"
+        "          [--vcd file] [--scope glob]... [--signal glob]... [--from vector] [--to vector]\n"
+        "          [--cycles n] [--checkpoint file] [--restore file]\n"
+#ifndef _WIN32
+        "          [-p processes]\n"
+#endif
+#ifdef LSC_TOGGLE_COVERAGE
+        "          [--toggles file]\n"
+#endif
+        ;
+
+    std::string stimulus, output = "-", toggles = "toggles.bin", checkpoint, restore;
+    bool write = true;
+    uint32_t processes = 1;
+    uint64_t limit = UINT64_MAX;
+    TraceOptions trace;
+
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool value = i + 1 < argc;
+
+        if ((arg == "-o" || arg == "--output") && value) output = argv[++i];
+        else if (arg == "-n" || arg == "--no-output") write = false;
+        else if (arg == "--vcd" && value) trace.path = argv[++i];
+        else if (arg == "--scope" && value) trace.scopes.push_back(argv[++i]);
+        else if (arg == "--signal" && value) trace.signals.push_back(argv[++i]);
+        else if (arg == "--from" && value) trace.from = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--to" && value) trace.to = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--cycles" && value) limit = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--checkpoint" && value) checkpoint = argv[++i];
+        else if (arg == "--restore" && value) restore = argv[++i];
+#ifdef LSC_TOGGLE_COVERAGE
+        else if (arg == "--toggles" && value) toggles = argv[++i];
+#endif
+#ifndef _WIN32
+        else if ((arg == "-p" || arg == "--processes") && value) processes = uint32_t(std::max(1L, std::strtol(argv[++i], nullptr, 10)));
+#endif
+        else if (stimulus.empty() && arg[0] != '-') stimulus = arg;
+        else
+        {
+            std::fprintf(stderr, usage, argv[0]);
+            return 2;
+        }
+    }
+
+    if (stimulus.empty())
+    {
+        std::fprintf(stderr, usage, argv[0]);
+        return 2;
+    }
+
+    MappedFile file(stimulus.c_str());
+
+    if (!file.isOpen())
+    {
+        std::fprintf(stderr, "Cannot read stimulus \"%s\"\n", stimulus.c_str());
+        return 1;
+    }
+
+    bool binary_out = !endsWith(output, ".csv") && output != "-";
+
+#ifndef _WIN32
+    // Workers share nothing but the mapped files: a sequential design needs
+    // the state of the previous vector, and traces and toggle counts are
+    // collected in order, so those run in one process.
+    if (processes > 1)
+    {
+        const char* reason = std::count(netlist.kinds, netlist.kinds + netlist.gates, REGISTER) > 0 ? "the design has registers"
+                           : !trace.path.empty() ? "--vcd is set"
+                           : nullptr;
+#ifdef LSC_TOGGLE_COVERAGE
+        reason = reason ? reason : "toggle coverage is enabled";
+#endif
+
+        if (!reason)
+        {
+            return runSharded(netlist, file, stimulus, !endsWith(stimulus, ".bin"), output, write, binary_out, processes);
+        }
+
+        std::fprintf(stderr, "Using 1 process: %s\n", reason);
+    }
+#endif
+
+    FILE* out = nullptr;
+
+    if (write)
+    {
+        out = output == "-" ? stdout : std::fopen(output.c_str(), "wb");
+
+        if (!out)
+        {
+            std::fprintf(stderr, "Cannot write \"%s\"\n", output.c_str());
+            return 1;
+        }
+    }
+
+    Simulator simulator(netlist);
+    StimulusReader reader(file, netlist.inputs, !endsWith(stimulus, ".bin"));
+    uint64_t total = 0;
+
+#ifdef LSC_TOGGLE_COVERAGE
+    simulator.setLookup(false);
+#else
+    simulator.setLookup(trace.path.empty());
+#endif
+
+    if ((!checkpoint.empty() || !restore.empty()) && !simulator.sequential())
+    {
+        std::fprintf(stderr, "Checkpoints need a design with registers\n");
+        return 2;
+    }
+
+    // A restored run continues with the vector after the snapshot's last
+    // cycle, and vector numbers in traces stay those of the whole run.
+    if (!restore.empty())
+    {
+        auto start = std::chrono::steady_clock::now();
+        MappedFile snapshot(restore.c_str());
+        std::string error = snapshot.isOpen() ? std::string() : "cannot read";
+
+        if (error.empty() && Snapshot::read(simulator, snapshot, &total, &error) && reader.skip(total) != total)
+        {
+            error = "stimulus has fewer vectors than the snapshot";
+        }
+
+        if (!error.empty())
+        {
+            std::fprintf(stderr, "%s: %s\n", restore.c_str(), error.c_str());
+            return 1;
+        }
+
+        std::fprintf(stderr, "Restored cycle %llu from \"%s\" in %.3f ms\n", (unsigned long long)total, restore.c_str(),
+                     std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    const uint64_t first = total;
+    bool written = true;
+    std::unique_ptr<Tracer> tracer;
+#ifdef LSC_TOGGLE_COVERAGE
+    ToggleCounter toggle_counter(netlist);
+#endif
+
+    if (!trace.path.empty())
+    {
+        tracer.reset(new Tracer(netlist, trace));
+
+        if (!tracer->isOpen())
+        {
+            std::fprintf(stderr, "Cannot write \"%s\"\n", trace.path.c_str());
+            return 1;
+        }
+    }
+
+    {
+        BufferedWriter writer(out);
+        std::vector<char> record(recordSize(netlist, binary_out));
+
+        if (write && !binary_out)
+        {
+            std::string header = csvHeader(netlist);
+            writer.write(header.data(), header.size());
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        Tracer::Channel channel = tracer ? tracer->channel() : Tracer::Channel::none();
+        uint32_t count;
+
+        while (total - first < limit && (count = reader.read(simulator)) > 0)
+        {
+            count = uint32_t(std::min<uint64_t>(count, limit - (total - first)));
+#ifdef LSC_TOGGLE_COVERAGE
+            toggle_counter.run(simulator, count);
+#else
+            simulator.run(count);
+#endif
+            channel.sample(simulator, total, count);
+            total += count;
+
+            for(uint32_t v = 0; v < count && write; v++)
+            {
+                formatRecord(simulator, v, binary_out, record.data());
+                writer.write(record.data(), record.size());
+            }
+        }
+
+        writer.flush();
+        written = !writer.failed();
+        channel.close();
+
+        if (tracer)
+        {
+            tracer->finish();
+
+            if (tracer->failed())
+            {
+                std::fprintf(stderr, "Cannot write \"%s\"\n", trace.path.c_str());
+                return 1;
+            }
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (!reader.error().empty())
+        {
+            std::fprintf(stderr, "%s: %s\n", stimulus.c_str(), reader.error().c_str());
+        }
+
+        std::fprintf(stderr, "%llu vector(s) in %.3f s, %.0f vectors/s\n",
+                     (unsigned long long)(total - first), seconds, seconds > 0 ? (total - first) / seconds : 0.0);
+
+        if (tracer)
+        {
+            std::fprintf(stderr, "Traced %zu signal(s), %llu change(s) to \"%s\"\n",
+                         tracer->signals(), (unsigned long long)tracer->changes(), trace.path.c_str());
+        }
+    }
+
+    if (out && out != stdout) written = std::fclose(out) == 0 && written;
+    if (out == stdout) written = std::fflush(stdout) == 0 && written;
+
+    if (!written)
+    {
+        std::fprintf(stderr, "Cannot write \"%s\"\n", output.c_str());
+        return 1;
+    }
+
+    if (!checkpoint.empty() && reader.error().empty())
+    {
+        if (!Snapshot::write(simulator, total, checkpoint.c_str()))
+        {
+            std::fprintf(stderr, "Cannot write \"%s\"\n", checkpoint.c_str());
+            return 1;
+        }
+
+        std::fprintf(stderr, "Wrote cycle %llu to \"%s\"\n", (unsigned long long)total, checkpoint.c_str());
+    }
+
+#ifdef LSC_TOGGLE_COVERAGE
+    if (!toggle_counter.write(toggles.c_str()))
+    {
+        std::fprintf(stderr, "Cannot write \"%s\"\n", toggles.c_str());
+        return 1;
+    }
+
+    std::fprintf(stderr, "Wrote toggle counts of %u net(s) to \"%s\"\n", netlist.nets(), toggles.c_str());
+#endif
+
+    return reader.error().empty() ? 0 : 1;
+}
+
+}
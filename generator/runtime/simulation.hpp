@@ -0,0 +1,769 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lsc {
+
+enum GateKind : uint8_t
+{
+    CONST0,
+    BUFFER,
+    NOT,
+    AND,
+    NAND,
+    OR,
+    NOR,
+    REGISTER
+};
+
+struct Netlist
+{
+    uint32_t inputs;
+    uint32_t outputs;
+    uint32_t gates;
+    const uint8_t* kinds;
+    const uint32_t* offsets;
+    const uint32_t* fanin;
+    const uint32_t* output_nets;
+    const char* const* input_names;
+    const char* const* output_names;
+    uint32_t scopes;
+    const char* const* scope_names;
+    const int32_t* scope_parents;
+    const uint32_t* gate_scopes;
+    const uint64_t* gate_ids;
+    uint64_t hash;
+    uint32_t luts;
+    uint32_t lut_scratch;
+    const uint32_t* lut_offsets;
+    const uint32_t* lut_leaves;
+    const uint32_t* lut_nets;
+    const uint64_t* lut_tables;
+
+    uint32_t nets() const { return inputs + gates; }
+};
+
+inline const char* kindName(uint8_t kind)
+{
+    static const char* const names[] = { "Const0", "Buffer", "Not", "And", "AndNot", "Or", "OrNot", "Register" };
+    return kind < sizeof(names) / sizeof(names[0]) ? names[kind] : "Gate";
+}
+
+using Word = uint64_t;
+
+// Evaluates 64 * lanes vectors per pass, one bit per vector. Gates are
+// stored in topological order, so a single sweep settles every net.
+//
+// A netlist with registers is sequential and run() treats vector v as clock
+// cycle v: the other gates are evaluated once, in the same order, on one
+// word per net, then all registers latch their inputs together. The value
+// of every net in cycle v is kept in bit v, so outputs, traces and toggle
+// counts read a pass the same way in both modes.
+//
+// A netlist mapped to lookup tables can evaluate each cycle with one table
+// lookup per LUT instead of one operation per gate. Only the LUT outputs
+// get values then, so outputs are the only nets kept for the pass.
+class Simulator
+{
+public:
+    static constexpr uint32_t lanes = 4;
+    static constexpr uint32_t vectors = 64 * lanes;
+
+    explicit Simulator(const Netlist& netlist):
+        _netlist(netlist),
+        _values(size_t(netlist.nets()) * lanes, 0)
+    {
+        for(uint32_t g = 0; g < netlist.gates; g++)
+        {
+            if (netlist.kinds[g] == REGISTER) _registers.push_back(g);
+        }
+
+        if (!_registers.empty())
+        {
+            _cycle.assign(netlist.nets() + netlist.lut_scratch, 0);
+            _latched.assign(_registers.size(), 0);
+        }
+    }
+
+    const Netlist& netlist() const { return _netlist; }
+
+    Word* net(uint32_t n) { return &_values[size_t(n) * lanes]; }
+    const Word* net(uint32_t n) const { return &_values[size_t(n) * lanes]; }
+    Word* input(uint32_t i) { return net(i); }
+    const Word* output(uint32_t o) const { return net(_netlist.output_nets[o]); }
+
+    void clearInputs()
+    {
+        std::memset(_values.data(), 0, size_t(_netlist.inputs) * lanes * sizeof(Word));
+    }
+
+    void setInput(uint32_t i, uint32_t vector)
+    {
+        input(i)[vector / 64] |= Word(1) << (vector % 64);
+    }
+
+    bool outputBit(uint32_t o, uint32_t vector) const
+    {
+        return (output(o)[vector / 64] >> (vector % 64)) & 1;
+    }
+
+    bool sequential() const { return !_registers.empty(); }
+
+    // Traces and toggle counts read every net, so they need the gates.
+    void setLookup(bool enabled) { _lookup = enabled && sequential() && _netlist.luts > 0; }
+    bool lookup() const { return _lookup; }
+
+    void evaluate()
+    {
+        sweep<lanes>(_netlist, _values.data(), [](uint32_t, uint32_t) {});
+    }
+
+    // Evaluates the first `count` vectors of the pass.
+    void run(uint32_t count)
+    {
+        run(count, [](uint32_t, uint32_t) {});
+    }
+
+    // Also calls visit(begin, end) for consecutive ranges of nets, in net
+    // order, as soon as their words for the pass are final. Without
+    // registers that is after every chunk of gates, while the chunk's words
+    // are still in the L1 cache.
+    template<typename Visit>
+    void run(uint32_t count, Visit&& visit)
+    {
+        if (_registers.empty())
+        {
+            visit(0, _netlist.inputs);
+            sweep<lanes>(_netlist, _values.data(), visit);
+            return;
+        }
+
+        const uint32_t nets = _netlist.nets();
+
+        for(uint32_t v = 0; v < count; v++)
+        {
+            const uint32_t lane = v / 64;
+            const Word bit = Word(1) << (v % 64);
+
+            for(uint32_t i = 0; i < _netlist.inputs; i++) _cycle[i] = (net(i)[lane] & bit) ? ~Word(0) : 0;
+
+            if (_lookup)
+            {
+                lookupTables(_netlist, _cycle.data());
+
+                for(uint32_t o = 0; o < _netlist.outputs; o++)
+                {
+                    Word& word = _values[size_t(_netlist.output_nets[o]) * lanes + lane];
+                    word = (word & ~bit) | (_cycle[_netlist.output_nets[o]] & bit);
+                }
+            }
+            else
+            {
+                sweep<1>(_netlist, _cycle.data(), [](uint32_t, uint32_t) {});
+
+                for(uint32_t n = _netlist.inputs; n < nets; n++)
+                {
+                    Word& word = _values[size_t(n) * lanes + lane];
+                    word = (word & ~bit) | (_cycle[n] & bit);
+                }
+            }
+
+            clock();
+        }
+
+        visit(0, nets);
+    }
+
+    // Latches every register from the values of the current cycle.
+    void clock()
+    {
+        for(size_t r = 0; r < _registers.size(); r++) _latched[r] = _cycle[_netlist.fanin[_netlist.offsets[_registers[r]]]];
+        for(size_t r = 0; r < _registers.size(); r++) _cycle[_netlist.inputs + _registers[r]] = _latched[r];
+    }
+
+    // Clears all registers.
+    void reset()
+    {
+        std::fill(_cycle.begin(), _cycle.end(), 0);
+    }
+
+    // Values of the last cycle, for snapshots.
+    bool stateBit(uint32_t n) const { return _cycle[n] & 1; }
+    void setStateBit(uint32_t n, bool value) { _cycle[n] = value ? ~Word(0) : 0; }
+
+private:
+    // Gates per visited range; their words take 8 KiB at four lanes.
+    static constexpr uint32_t chunk = 256;
+
+    // A register keeps the value of its net during the sweep.
+    template<uint32_t L, typename Visit>
+    static void sweep(const Netlist& netlist, Word* values, Visit&& visit)
+    {
+        const uint8_t* kinds = netlist.kinds;
+        const uint32_t* offsets = netlist.offsets;
+        const uint32_t* fanin = netlist.fanin;
+        Word* out = values + size_t(netlist.inputs) * L;
+        auto net = [values](uint32_t n) { return values + size_t(n) * L; };
+
+        for(uint32_t begin = 0; begin < netlist.gates; begin += chunk)
+        {
+            const uint32_t end = std::min(netlist.gates, begin + chunk);
+
+            for(uint32_t g = begin; g < end; g++, out += L)
+            {
+                const uint32_t* f = fanin + offsets[g];
+                const uint32_t n = offsets[g + 1] - offsets[g];
+
+                switch (kinds[g])
+                {
+                case CONST0:
+                    fill<L>(out, 0);
+                    break;
+                case BUFFER:
+                    copy<L>(out, net(f[0]), 0);
+                    break;
+                case NOT:
+                    copy<L>(out, net(f[0]), ~Word(0));
+                    break;
+                case AND:
+                case NAND:
+                    copy<L>(out, net(f[0]), 0);
+                    for(uint32_t i = 1; i < n; i++) { const Word* in = net(f[i]); for(uint32_t l = 0; l < L; l++) out[l] &= in[l]; }
+                    if (kinds[g] == NAND) invert<L>(out);
+                    break;
+                case OR:
+                case NOR:
+                    copy<L>(out, net(f[0]), 0);
+                    for(uint32_t i = 1; i < n; i++) { const Word* in = net(f[i]); for(uint32_t l = 0; l < L; l++) out[l] |= in[l]; }
+                    if (kinds[g] == NOR) invert<L>(out);
+                    break;
+                case REGISTER:
+                    break;
+                }
+            }
+
+            visit(netlist.inputs + begin, netlist.inputs + end);
+        }
+    }
+
+    // Values are all zeros or all ones, so bit 0 of each leaf is its value.
+    static void lookupTables(const Netlist& netlist, Word* values)
+    {
+        for(uint32_t t = 0; t < netlist.luts; t++)
+        {
+            const uint32_t* leaf = netlist.lut_leaves + netlist.lut_offsets[t];
+            const uint32_t n = netlist.lut_offsets[t + 1] - netlist.lut_offsets[t];
+            uint32_t index = 0;
+
+            for(uint32_t i = 0; i < n; i++) index |= uint32_t(values[leaf[i]] & 1) << i;
+
+            values[netlist.lut_nets[t]] = Word(0) - ((netlist.lut_tables[t] >> index) & 1);
+        }
+    }
+
+    template<uint32_t L> static void fill(Word* out, Word value) { for(uint32_t l = 0; l < L; l++) out[l] = value; }
+    template<uint32_t L> static void copy(Word* out, const Word* in, Word mask) { for(uint32_t l = 0; l < L; l++) out[l] = in[l] ^ mask; }
+    template<uint32_t L> static void invert(Word* out) { for(uint32_t l = 0; l < L; l++) out[l] = ~out[l]; }
+
+    const Netlist& _netlist;
+    std::vector<Word> _values;
+    std::vector<uint32_t> _registers;
+    std::vector<Word> _cycle;
+    std::vector<Word> _latched;
+    bool _lookup = false;
+};
+
+inline uint32_t popcount(Word word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return uint32_t(__builtin_popcountll(word));
+#else
+    word = word - ((word >> 1) & 0x5555555555555555ull);
+    word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+    word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return uint32_t((word * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// Index of the lowest set bit of a non-zero word.
+inline uint32_t lowestBit(Word word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return uint32_t(__builtin_ctzll(word));
+#else
+    return popcount((word & (~word + 1)) - 1);
+#endif
+}
+
+// Per-net toggle counts. Each pass XORs every net word with itself shifted
+// by one vector, carrying the last bit across words and passes, and adds the
+// popcount of the result. Counting runs inside the simulator's sweep after
+// every chunk of gates, while their words are still in the L1 cache, instead
+// of streaming all nets through the cache a second time. The dump is
+// "LSCTOGGL", a uint32 version, a uint32 net count, the netlist hash, a
+// uint64 vector count and one uint64 count per net, all little endian, in
+// netlist net order.
+class ToggleCounter
+{
+public:
+    explicit ToggleCounter(const Netlist& netlist):
+        _hash(netlist.hash),
+        _counts(netlist.nets(), 0),
+        _last(netlist.nets(), 0)
+    {
+    }
+
+    // Runs the first `count` vectors of a pass and counts their toggles.
+    void run(Simulator& simulator, uint32_t count)
+    {
+        static_assert(Simulator::lanes == 4, "add() reads four lanes per net");
+
+        for(uint32_t l = 0; l < Simulator::lanes; l++)
+        {
+            uint32_t bits = count > l * 64 ? std::min<uint32_t>(count - l * 64, 64) : 0;
+            _valid[l] = bits == 64 ? ~Word(0) : (Word(1) << bits) - 1;
+        }
+
+        // The first vector of the run has nothing to toggle from.
+        if (_vectors == 0) _valid[0] &= ~Word(1);
+
+        _last_lane = (count - 1) / 64;
+        _last_bit = (count - 1) % 64;
+
+        if (count == Simulator::vectors && _vectors > 0)
+        {
+            simulator.run(count, [this, &simulator](uint32_t begin, uint32_t end) { add<true>(simulator, begin, end); });
+        }
+        else
+        {
+            simulator.run(count, [this, &simulator](uint32_t begin, uint32_t end) { add<false>(simulator, begin, end); });
+        }
+
+        _vectors += count;
+    }
+
+    const std::vector<uint64_t>& counts() const { return _counts; }
+    uint64_t vectors() const { return _vectors; }
+
+    bool write(const char* path) const
+    {
+        FILE* file = std::fopen(path, "wb");
+
+        if (!file)
+        {
+            return false;
+        }
+
+        std::vector<unsigned char> data(8 + 4 + 4 + 8 * (2 + _counts.size()));
+        unsigned char* out = data.data();
+        auto put = [&out](uint64_t value, int bytes) { for(int i = 0; i < bytes; i++) *out++ = (unsigned char)(value >> (8 * i)); };
+
+        std::memcpy(out, "LSCTOGGL", 8);
+        out += 8;
+        put(2, 4);
+        put(_counts.size(), 4);
+        put(_hash, 8);
+        put(_vectors, 8);
+
+        for(uint64_t count : _counts) put(count, 8);
+
+        bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+private:
+    // A full pass after the first one needs no masks, and its last vector
+    // is bit 63 of the last lane.
+    template<bool Full>
+    void add(const Simulator& simulator, uint32_t begin, uint32_t end)
+    {
+        const Word v0 = _valid[0], v1 = _valid[1], v2 = _valid[2], v3 = _valid[3];
+        const uint32_t last_lane = Full ? Simulator::lanes - 1 : _last_lane, last_bit = Full ? 63 : _last_bit;
+        const Word* word = simulator.net(begin);
+        uint64_t* counts = _counts.data();
+        uint8_t* last = _last.data();
+
+        for(uint32_t n = begin; n < end; n++, word += Simulator::lanes)
+        {
+            Word t0 = word[0] ^ ((word[0] << 1) | last[n]);
+            Word t1 = word[1] ^ ((word[1] << 1) | (word[0] >> 63));
+            Word t2 = word[2] ^ ((word[2] << 1) | (word[1] >> 63));
+            Word t3 = word[3] ^ ((word[3] << 1) | (word[2] >> 63));
+
+            if (!Full)
+            {
+                t0 &= v0;
+                t1 &= v1;
+                t2 &= v2;
+                t3 &= v3;
+            }
+
+            counts[n] += popcount(t0) + popcount(t1) + popcount(t2) + popcount(t3);
+            last[n] = uint8_t((word[last_lane] >> last_bit) & 1);
+        }
+    }
+
+    uint64_t _hash;
+    std::vector<uint64_t> _counts;
+    std::vector<uint8_t> _last;
+    uint64_t _vectors = 0;
+    Word _valid[Simulator::lanes] = {};
+    uint32_t _last_lane = 0;
+    uint32_t _last_bit = 0;
+};
+
+class MappedFile;
+
+// Snapshot of a sequential simulation after a number of cycles: every net's
+// value in the last cycle, one bit per net. The file is "LSCSNAPS", a uint32
+// version, a uint32 net count, the netlist hash, a uint64 cycle count and
+// ceil(nets / 8) bytes of values, all little endian. A snapshot is rejected
+// unless the netlist hash, which covers every gate, its fanin nets and the
+// output nets in their emitted order, matches.
+class Snapshot
+{
+public:
+    static bool write(const Simulator& simulator, uint64_t cycles, const char* path)
+    {
+        const Netlist& netlist = simulator.netlist();
+        std::vector<unsigned char> data(header + (netlist.nets() + 7) / 8, 0);
+        unsigned char* out = data.data();
+        auto put = [&out](uint64_t value, int bytes) { for(int i = 0; i < bytes; i++) *out++ = (unsigned char)(value >> (8 * i)); };
+
+        std::memcpy(out, "LSCSNAPS", 8);
+        out += 8;
+        put(version, 4);
+        put(netlist.nets(), 4);
+        put(netlist.hash, 8);
+        put(cycles, 8);
+
+        for(uint32_t n = 0; n < netlist.nets(); n++) out[n / 8] |= (unsigned char)(simulator.stateBit(n) << (n % 8));
+
+        FILE* file = std::fopen(path, "wb");
+
+        if (!file)
+        {
+            return false;
+        }
+
+        bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+    static bool read(Simulator& simulator, const MappedFile& file, uint64_t* cycles, std::string* error);
+
+private:
+    static constexpr uint32_t version = 1;
+    static constexpr size_t header = 8 + 4 + 4 + 8 + 8;
+};
+
+class MappedFile
+{
+public:
+    explicit MappedFile(const char* path)
+    {
+#ifndef _WIN32
+        int fd = ::open(path, O_RDONLY);
+        struct stat info;
+
+        if (fd >= 0 && ::fstat(fd, &info) == 0)
+        {
+            _size = size_t(info.st_size);
+            void* data = _size ? ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+
+            if (data != MAP_FAILED)
+            {
+                _data = static_cast<const char*>(data);
+                _mapped = data != nullptr;
+                _open = true;
+#ifdef MADV_SEQUENTIAL
+                if (_mapped) ::madvise(data, _size, MADV_SEQUENTIAL);
+#endif
+            }
+        }
+
+        if (fd >= 0) ::close(fd);
+#endif
+        if (!_open)
+        {
+            FILE* file = std::fopen(path, "rb");
+
+            if (file)
+            {
+                char chunk[1 << 16];
+                size_t n;
+
+                while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) _copy.insert(_copy.end(), chunk, chunk + n);
+
+                std::fclose(file);
+                _data = _copy.data();
+                _size = _copy.size();
+                _open = true;
+            }
+        }
+    }
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (_mapped) ::munmap(const_cast<char*>(_data), _size);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return _open; }
+    const char* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const char* _data = nullptr;
+    size_t _size = 0;
+    bool _mapped = false;
+    bool _open = false;
+    std::vector<char> _copy;
+};
+
+inline bool Snapshot::read(Simulator& simulator, const MappedFile& file, uint64_t* cycles, std::string* error)
+{
+    const Netlist& netlist = simulator.netlist();
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(file.data());
+    auto get = [&data](size_t offset, int bytes) { uint64_t value = 0; for(int i = 0; i < bytes; i++) value |= uint64_t(data[offset + i]) << (8 * i); return value; };
+
+    if (file.size() < header || std::memcmp(data, "LSCSNAPS", 8) != 0 || get(8, 4) != version)
+    {
+        *error = "not a snapshot";
+        return false;
+    }
+
+    if (get(12, 4) != netlist.nets() || get(16, 8) != netlist.hash || file.size() != header + (netlist.nets() + 7) / 8)
+    {
+        *error = "snapshot of another design";
+        return false;
+    }
+
+    *cycles = get(24, 8);
+
+    for(uint32_t n = 0; n < netlist.nets(); n++) simulator.setStateBit(n, (data[header + n / 8] >> (n % 8)) & 1);
+
+    return true;
+}
+
+// CSV stimulus: one vector per line, one 0/1 value per primary input in
+// declaration order, separated by commas or blanks. Lines starting with
+// '#' or a letter (a header with input names) are skipped.
+// Binary stimulus: ceil(inputs / 8) bytes per vector, input i in bit i % 8
+// of byte i / 8.
+class StimulusReader
+{
+public:
+    StimulusReader(const MappedFile& file, uint32_t inputs, bool csv):
+        StimulusReader(file.data(), file.data() + file.size(), inputs, csv)
+    {
+    }
+
+    // Reads a slice of a stimulus that starts after line `line`.
+    StimulusReader(const char* begin, const char* end, uint32_t inputs, bool csv, size_t line = 0):
+        _begin(begin),
+        _end(end),
+        _inputs(inputs),
+        _csv(csv),
+        _stride((inputs + 7) / 8),
+        _line(line)
+    {
+    }
+
+    const std::string& error() const { return _error; }
+
+    // A CSV line is a vector when its first value character is 0 or 1.
+    static bool isVector(const char* line, const char* eol)
+    {
+        for(const char* c = line; c < eol; c++)
+        {
+            if (*c != ',' && *c != ' ' && *c != '\t' && *c != '\r' && *c != ';') return *c == '0' || *c == '1';
+        }
+
+        return false;
+    }
+
+    // Skips up to `vectors` vectors without evaluating them.
+    uint64_t skip(uint64_t vectors)
+    {
+        uint64_t skipped = 0;
+
+        while (skipped < vectors && _begin < _end)
+        {
+            if (!_csv)
+            {
+                if (size_t(_end - _begin) < _stride || _stride == 0) break;
+                _begin += _stride;
+                skipped++;
+                continue;
+            }
+
+            const char* eol = static_cast<const char*>(std::memchr(_begin, '\n', size_t(_end - _begin)));
+            eol = eol ? eol : _end;
+            skipped += isVector(_begin, eol) ? 1 : 0;
+            _begin = eol < _end ? eol + 1 : _end;
+            _line++;
+        }
+
+        return skipped;
+    }
+
+    uint32_t read(Simulator& simulator)
+    {
+        simulator.clearInputs();
+        uint32_t count = 0;
+
+        while (count < Simulator::vectors && _error.empty() && (_csv ? readLine(simulator, count) : readRecord(simulator, count)))
+        {
+            count++;
+        }
+
+        return _error.empty() ? count : 0;
+    }
+
+private:
+    bool readRecord(Simulator& simulator, uint32_t vector)
+    {
+        if (size_t(_end - _begin) < _stride || _stride == 0)
+        {
+            return false;
+        }
+
+        const unsigned char* record = reinterpret_cast<const unsigned char*>(_begin);
+
+        for(uint32_t i = 0; i < _inputs; i++)
+        {
+            if ((record[i / 8] >> (i % 8)) & 1) simulator.setInput(i, vector);
+        }
+
+        _begin += _stride;
+        return true;
+    }
+
+    bool readLine(Simulator& simulator, uint32_t vector)
+    {
+        while (_begin < _end)
+        {
+            const char* line = _begin;
+            const char* eol = static_cast<const char*>(std::memchr(line, '\n', size_t(_end - line)));
+            eol = eol ? eol : _end;
+            _begin = eol < _end ? eol + 1 : _end;
+            _line++;
+
+            uint32_t values = 0;
+            bool skip = true;
+
+            for(const char* c = line; c < eol; c++)
+            {
+                if (*c == '0' || *c == '1')
+                {
+                    if (values < _inputs && *c == '1') simulator.setInput(values, vector);
+                    values++;
+                    skip = false;
+                }
+                else if (*c == '#' || (skip && ((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || *c == '_')))
+                {
+                    break;
+                }
+                else if (*c != ',' && *c != ' ' && *c != '\t' && *c != '\r' && *c != ';')
+                {
+                    _error = "line " + std::to_string(_line) + ": unexpected character '" + *c + "'";
+                    return false;
+                }
+            }
+
+            if (skip)
+            {
+                continue;
+            }
+
+            if (values != _inputs)
+            {
+                _error = "line " + std::to_string(_line) + ": expected " + std::to_string(_inputs) + " value(s), got " + std::to_string(values);
+                return false;
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+    const char* _begin;
+    const char* _end;
+    uint32_t _inputs;
+    bool _csv;
+    size_t _stride;
+    size_t _line;
+    std::string _error;
+};
+
+class BufferedWriter
+{
+public:
+    explicit BufferedWriter(FILE* file, size_t capacity = size_t(1) << 22):
+        _file(file),
+        _buffer(capacity)
+    {
+    }
+
+    ~BufferedWriter() { flush(); }
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    void put(char c)
+    {
+        if (_used == _buffer.size()) flush();
+        _buffer[_used++] = c;
+    }
+
+    void write(const char* data, size_t size)
+    {
+        if (_used + size > _buffer.size()) flush();
+
+        if (size > _buffer.size())
+        {
+            if (_file && std::fwrite(data, 1, size, _file) != size) _failed = true;
+            return;
+        }
+
+        std::memcpy(_buffer.data() + _used, data, size);
+        _used += size;
+    }
+
+    void flush()
+    {
+        if (_file && _used && std::fwrite(_buffer.data(), 1, _used, _file) != _used) _failed = true;
+        _used = 0;
+    }
+
+    // True once a write came up short, e.g. on a full disk.
+    bool failed() const { return _failed || (_file && std::ferror(_file)); }
+
+private:
+    FILE* _file;
+    std::vector<char> _buffer;
+    size_t _used = 0;
+    bool _failed = false;
+};
+
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// Primitive blocks of the static backend. Every block, primitive or
+// generated, exposes fixed-size `inputs` and `outputs` arrays and an inline
+// evaluate(), so parents hold their blocks by value and the compiler can
+// inline through the whole hierarchy. Ports are packed 64 bits to a word:
+// bit b of a port array is bit b % 64 of word b / 64, read and written with
+// bit() and setBit(). A primitive of width W is a bus primitive: bit b of
+// input port i is bit i * W + b, and the operation is applied a word at a
+// time.
+namespace lsc {
+
+constexpr std::size_t words(std::size_t bits) { return (bits + 63) / 64; }
+
+constexpr uint64_t mask(std::size_t bits) { return bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1; }
+
+template<std::size_t Words>
+bool bit(const std::array<uint64_t, Words>& words, std::size_t index)
+{
+    return (words[index / 64] >> (index % 64)) & 1;
+}
+
+template<std::size_t Words>
+void setBit(std::array<uint64_t, Words>& words, std::size_t index, bool value)
+{
+    uint64_t& word = words[index / 64];
+    word = (word & ~(uint64_t(1) << (index % 64))) | (uint64_t(value) << (index % 64));
+}
+
+// Up to 64 bits starting at `position`, which may straddle two words.
+template<std::size_t Words>
+uint64_t field(const std::array<uint64_t, Words>& words, std::size_t position, std::size_t bits)
+{
+    std::size_t shift = position % 64;
+    uint64_t value = words[position / 64] >> shift;
+
+    if (shift + bits > 64)
+    {
+        value |= words[position / 64 + 1] << (64 - shift);
+    }
+
+    return value & mask(bits);
+}
+
+// Generated code assembles each input word of a block from the fields that
+// drive it: target.inputs[w] = lsc::extract<Position, Bits>(source) << shift
+// | ... Positions are template arguments, so this compiles to a few shifts
+// and masks per word.
+template<std::size_t Position, std::size_t Bits, std::size_t Words>
+uint64_t extract(const std::array<uint64_t, Words>& words)
+{
+    static_assert(Bits > 0 && Bits <= 64 && Position + Bits <= Words * 64, "field out of range");
+    return field(words, Position, Bits);
+}
+
+template<std::size_t Inputs, std::size_t Width = 1>
+struct StaticBlock
+{
+    static constexpr std::size_t input_count = Inputs * Width;
+    static constexpr std::size_t output_count = Width;
+
+    std::array<uint64_t, words(Inputs * Width)> inputs {};
+    std::array<uint64_t, words(Width)> outputs {};
+
+protected:
+    // Applies op to the N ports a word of output bits at a time. Narrow
+    // gates have all of their ports in the first word.
+    template<std::size_t N, typename Op>
+    void combine(uint64_t initial, Op op)
+    {
+        if constexpr (N * Width <= 64)
+        {
+            uint64_t value = initial;
+            for(std::size_t i = 0; i < N; i++) value = op(value, inputs[0] >> (i * Width));
+            outputs[0] = value & mask(Width);
+        }
+        else
+        {
+            for(std::size_t bit = 0; bit < Width; bit += 64)
+            {
+                std::size_t step = Width - bit < 64 ? Width - bit : 64;
+                uint64_t value = initial;
+                for(std::size_t i = 0; i < N; i++) value = op(value, field(inputs, i * Width + bit, step));
+                outputs[bit / 64] = value & mask(step);
+            }
+        }
+    }
+
+    void invert()
+    {
+        for(std::size_t word = 0; word < outputs.size(); word++) outputs[word] = ~outputs[word] & mask(Width - word * 64);
+    }
+};
+
+template<std::size_t W = 1>
+struct Buffer : StaticBlock<1, W>
+{
+    void evaluate() { this->outputs = this->inputs; }
+};
+
+template<std::size_t W = 1>
+struct Not : StaticBlock<1, W>
+{
+    void evaluate() { this->outputs = this->inputs; this->invert(); }
+};
+
+template<std::size_t N, std::size_t W = 1>
+struct And : StaticBlock<N, W>
+{
+    void evaluate()
+    {
+        if constexpr (W == 1 && N <= 64) this->outputs[0] = (this->inputs[0] & mask(N)) == mask(N);
+        else this->template combine<N>(~uint64_t(0), [](uint64_t a, uint64_t b) { return a & b; });
+    }
+};
+
+template<std::size_t N, std::size_t W = 1>
+struct AndNot : And<N, W>
+{
+    void evaluate() { And<N, W>::evaluate(); this->invert(); }
+};
+
+template<std::size_t N, std::size_t W = 1>
+struct Or : StaticBlock<N, W>
+{
+    void evaluate()
+    {
+        if constexpr (W == 1 && N <= 64) this->outputs[0] = (this->inputs[0] & mask(N)) != 0;
+        else this->template combine<N>(0, [](uint64_t a, uint64_t b) { return a | b; });
+    }
+};
+
+template<std::size_t N, std::size_t W = 1>
+struct OrNot : Or<N, W>
+{
+    void evaluate() { Or<N, W>::evaluate(); this->invert(); }
+};
+
+// A D flip-flop per bit. evaluate() drives the outputs from the stored
+// state, and clock() stores the inputs copied in by the last evaluate().
+// A sequential design calls clock() on all of its registers after each
+// evaluate(), so they all latch together.
+template<std::size_t W = 1>
+struct Register : StaticBlock<1, W>
+{
+    std::array<uint64_t, words(W)> state {};
+
+    void evaluate() { this->outputs = state; }
+    void clock() { state = this->inputs; }
+};
+
+// Memoization of generated blocks. A memoized block's evaluate() looks its
+// packed inputs up instead of calling compute(). Blocks with up to 16 inputs
+// get a truth table filled on first use, larger ones a direct-mapped cache
+// of the last results. Counters are per type; memoReport() prints them.
+// Tables and counters are shared by all instances and are not thread-safe.
+struct MemoStats
+{
+    const char* name;
+    const char* kind;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    MemoStats* next = nullptr;
+
+    MemoStats(const char* type_name, const char* memo_kind):
+        name(type_name),
+        kind(memo_kind),
+        next(registry())
+    {
+        registry() = this;
+    }
+
+    static MemoStats*& registry()
+    {
+        static MemoStats* head = nullptr;
+        return head;
+    }
+};
+
+inline void memoReport(FILE* out = stdout)
+{
+    for(const MemoStats* stats = MemoStats::registry(); stats; stats = stats->next)
+    {
+        uint64_t total = stats->hits + stats->misses;
+        std::fprintf(out, "%-32s %-12s %12llu hit(s) %12llu miss(es) %6.2f%%\n", stats->name, stats->kind,
+                     static_cast<unsigned long long>(stats->hits), static_cast<unsigned long long>(stats->misses),
+                     total ? 100.0 * stats->hits / total : 0.0);
+    }
+}
+
+// Memoized blocks have at most 64 inputs and outputs, so each port array is
+// a single word.
+template<typename Block>
+uint64_t packInputs(const Block& block)
+{
+    return block.inputs[0] & mask(Block::input_count);
+}
+
+template<typename Block>
+uint64_t packOutputs(const Block& block)
+{
+    if constexpr (Block::output_count == 0) return 0;
+    else return block.outputs[0] & mask(Block::output_count);
+}
+
+template<typename Block>
+void unpackOutputs(Block& block, uint64_t value)
+{
+    if constexpr (Block::output_count > 0) block.outputs[0] = value;
+}
+
+template<typename Block>
+struct TruthTable
+{
+    static_assert(Block::input_count <= 16 && Block::output_count <= 64, "truth table too large");
+
+    static void evaluate(Block& block, const char* name)
+    {
+        static MemoStats stats(name, "truth-table");
+        static const std::vector<uint64_t> table = build(stats);
+
+        stats.hits++;
+        unpackOutputs(block, table[packInputs(block)]);
+    }
+
+private:
+    static std::vector<uint64_t> build(MemoStats& stats)
+    {
+        std::vector<uint64_t> table(std::size_t(1) << Block::input_count);
+        std::unique_ptr<Block> block(new Block());
+
+        for(uint64_t key = 0; key < table.size(); key++)
+        {
+            block->inputs[0] = key;
+            block->compute();
+            table[key] = packOutputs(*block);
+        }
+
+        stats.misses += table.size();
+        return table;
+    }
+};
+
+template<typename Block, std::size_t Entries = 4096>
+struct ResultCache
+{
+    static_assert(Block::input_count <= 64 && Block::output_count <= 64, "block too wide to cache");
+    static_assert((Entries & (Entries - 1)) == 0, "entry count must be a power of two");
+
+    static void evaluate(Block& block, const char* name)
+    {
+        struct Entry
+        {
+            uint64_t key = 0;
+            uint64_t value = 0;
+            bool valid = false;
+        };
+
+        static MemoStats stats(name, "cache");
+        static std::vector<Entry> entries(Entries);
+
+        uint64_t key = packInputs(block);
+        uint64_t hash = key * 0x9e3779b97f4a7c15ull;
+        Entry& entry = entries[(hash ^ (hash >> 29)) & (Entries - 1)];
+
+        if (entry.valid && entry.key == key)
+        {
+            stats.hits++;
+            unpackOutputs(block, entry.value);
+            return;
+        }
+
+        stats.misses++;
+        block.compute();
+        entry.key = key;
+        entry.value = packOutputs(block);
+        entry.valid = true;
+    }
+};
+
+}
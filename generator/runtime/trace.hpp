@@ -0,0 +1,457 @@
+#pragma once
+
+#include "simulation.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace lsc {
+
+struct TraceOptions
+{
+    std::string path;
+    std::vector<std::string> scopes;
+    std::vector<std::string> signals;
+    uint64_t from = 0;
+    uint64_t to = UINT64_MAX;
+};
+
+inline bool globMatch(const char* pattern, const char* text)
+{
+    const char* star = nullptr;
+    const char* resume = nullptr;
+
+    while (*text)
+    {
+        if (*pattern == '*') { star = pattern++; resume = text; }
+        else if (*pattern == '?' || *pattern == *text) { pattern++; text++; }
+        else if (star) { pattern = star + 1; text = ++resume; }
+        else return false;
+    }
+
+    while (*pattern == '*') pattern++;
+    return !*pattern;
+}
+
+// Writes value changes of the selected nets as VCD, one time step per
+// vector. A simulating thread only copies the traced words of each
+// evaluated block into the ring of its Channel; a background thread finds
+// the changes, merges the channels by time and formats the file. A full
+// ring makes its producer wait, without spinning, until the writer frees a
+// slot, which bounds memory.
+class Tracer
+{
+private:
+    struct Ring
+    {
+        Ring(size_t slots, size_t words): data(slots * words), time(slots), count(slots), slots(slots) {}
+
+        std::vector<Word> data;
+        std::vector<uint64_t> time;
+        std::vector<uint32_t> count;
+        size_t slots;
+        std::atomic<size_t> head { 0 };
+        std::atomic<size_t> tail { 0 };
+        std::atomic<bool> closed { false };
+    };
+
+public:
+    class Channel
+    {
+    public:
+        Channel(Channel&& other): _tracer(other._tracer), _ring(other._ring) { other._ring = nullptr; }
+        static Channel none() { return Channel(nullptr, nullptr); }
+        ~Channel() { close(); }
+
+        Channel(const Channel&) = delete;
+        Channel& operator=(const Channel&) = delete;
+
+        // Records the vectors [time, time + count) held by the simulator.
+        void sample(const Simulator& simulator, uint64_t time, uint32_t count)
+        {
+            if (_ring) _tracer->push(*_ring, simulator, time, count);
+        }
+
+        void close()
+        {
+            if (_ring)
+            {
+                _ring->closed.store(true, std::memory_order_release);
+                _tracer->_wake.notify_one();
+                _ring = nullptr;
+            }
+        }
+
+    private:
+        friend class Tracer;
+        Channel(Tracer* tracer, Ring* ring): _tracer(tracer), _ring(ring) {}
+
+        Tracer* _tracer;
+        Ring* _ring;
+    };
+
+    Tracer(const Netlist& netlist, const TraceOptions& options):
+        _netlist(netlist),
+        _options(options)
+    {
+        if (_options.scopes.empty()) _options.scopes.push_back(netlist.scopes ? netlist.scope_names[0] : "*");
+        if (_options.signals.empty()) _options.signals.push_back("*");
+
+        _file = std::fopen(options.path.c_str(), "wb");
+
+        if (_file)
+        {
+            std::setvbuf(_file, nullptr, _IOFBF, size_t(1) << 20);
+            select();
+            writeHeader();
+            _last.assign(_nets.size(), 0);
+            _known.assign(_nets.size(), 0);
+            _changed.assign(_nets.size(), 0);
+            _writer = std::thread([this]() { run(); });
+        }
+    }
+
+    ~Tracer()
+    {
+        finish();
+    }
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    bool isOpen() const { return _file != nullptr; }
+    bool failed() const { return _failed; }
+    size_t signals() const { return _nets.size(); }
+    uint64_t changes() const { return _changes.load(); }
+
+    Channel channel()
+    {
+        if (!_file || _nets.empty())
+        {
+            return Channel(this, nullptr);
+        }
+
+        size_t words = _nets.size() * Simulator::lanes;
+        size_t slots = std::max<size_t>(2, std::min<size_t>(256, (size_t(16) << 20) / (words * sizeof(Word))));
+        std::lock_guard<std::mutex> lock(_mutex);
+        _rings.emplace_back(new Ring(slots, words));
+        return Channel(this, _rings.back().get());
+    }
+
+    // Waits until every channel is closed and everything is written.
+    void finish()
+    {
+        if (_writer.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _done = true;
+            }
+
+            _wake.notify_one();
+            _writer.join();
+        }
+
+        if (_file)
+        {
+            _failed = std::ferror(_file) != 0;
+            _failed = std::fclose(_file) != 0 || _failed;
+            _file = nullptr;
+        }
+    }
+
+private:
+    struct Declaration
+    {
+        uint32_t signal;
+        std::string name;
+    };
+
+    void push(Ring& ring, const Simulator& simulator, uint64_t time, uint32_t count)
+    {
+        if (time > _options.to || time + count <= _options.from)
+        {
+            return;
+        }
+
+        size_t head = ring.head.load(std::memory_order_relaxed);
+
+        if (head - ring.tail.load(std::memory_order_acquire) == ring.slots)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.notify_one();
+            _space.wait(lock, [&]() { return head - ring.tail.load(std::memory_order_acquire) < ring.slots; });
+        }
+
+        size_t slot = head % ring.slots;
+        Word* out = &ring.data[slot * _nets.size() * Simulator::lanes];
+
+        for(uint32_t net : _nets)
+        {
+            std::memcpy(out, simulator.net(net), Simulator::lanes * sizeof(Word));
+            out += Simulator::lanes;
+        }
+
+        ring.time[slot] = time;
+        ring.count[slot] = count;
+        ring.head.store(head + 1, std::memory_order_release);
+
+        if (head % 8 == 0) _wake.notify_one();
+    }
+
+    void run()
+    {
+        for(;;)
+        {
+            bool done;
+
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait_for(lock, std::chrono::milliseconds(2));
+                done = _done;
+            }
+
+            while (drain(done)) {}
+
+            if (done)
+            {
+                break;
+            }
+        }
+
+        std::fflush(_file);
+    }
+
+    // Writes the oldest pending block. Blocks are only taken once every open
+    // channel has one pending, so the file stays ordered by time.
+    bool drain(bool done)
+    {
+        std::vector<Ring*> rings;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for(auto& ring : _rings) rings.push_back(ring.get());
+        }
+
+        Ring* next = nullptr;
+
+        for(Ring* ring : rings)
+        {
+            bool closed = ring->closed.load(std::memory_order_acquire);
+            size_t tail = ring->tail.load(std::memory_order_relaxed);
+
+            if (tail == ring->head.load(std::memory_order_acquire))
+            {
+                if (!closed && !done) return false;
+                continue;
+            }
+
+            if (!next || ring->time[tail % ring->slots] < next->time[next->tail.load(std::memory_order_relaxed) % next->slots])
+            {
+                next = ring;
+            }
+        }
+
+        if (!next)
+        {
+            return false;
+        }
+
+        size_t slot = next->tail.load(std::memory_order_relaxed) % next->slots;
+        writeBlock(&next->data[slot * _nets.size() * Simulator::lanes], next->time[slot], next->count[slot]);
+        next->tail.fetch_add(1, std::memory_order_release);
+
+        // A producer waiting for space checks the tail under the mutex, so
+        // taking it here makes sure the wakeup is not lost.
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+        }
+
+        _space.notify_all();
+        return true;
+    }
+
+    void writeBlock(const Word* words, uint64_t time, uint32_t count)
+    {
+        for(uint32_t lane = 0; lane < Simulator::lanes && lane * 64 < count; lane++)
+        {
+            uint64_t base = time + lane * 64;
+            uint32_t valid = std::min<uint32_t>(64, count - lane * 64);
+            Word mask = valid == 64 ? ~Word(0) : (Word(1) << valid) - 1;
+
+            if (base < _options.from) mask &= _options.from - base >= 64 ? 0 : ~Word(0) << (_options.from - base);
+            if (base > _options.to) mask = 0;
+            else if (_options.to - base < 63) mask &= (Word(2) << (_options.to - base)) - 1;
+
+            Word any = 0;
+
+            for(size_t s = 0; s < _nets.size(); s++)
+            {
+                Word value = words[s * Simulator::lanes + lane];
+                Word changed = (value ^ ((value << 1) | _last[s])) & mask;
+
+                if (!_known[s] && mask)
+                {
+                    changed |= mask & (~mask + 1);
+                    _known[s] = 1;
+                }
+
+                _changed[s] = changed;
+                _last[s] = (value >> (valid - 1)) & 1;
+                any |= changed;
+            }
+
+            while (any)
+            {
+                uint32_t bit = lowestBit(any);
+                std::fprintf(_file, "#%llu\n", (unsigned long long)(base + bit));
+
+                for(size_t s = 0; s < _nets.size(); s++)
+                {
+                    if ((_changed[s] >> bit) & 1)
+                    {
+                        std::fputc('0' + int((words[s * Simulator::lanes + lane] >> bit) & 1), _file);
+                        std::fputs(_codes[s].c_str(), _file);
+                        std::fputc('\n', _file);
+                        _changes++;
+                    }
+                }
+
+                any &= any - 1;
+            }
+        }
+    }
+
+    std::string scopePath(uint32_t scope) const
+    {
+        std::string path = _netlist.scope_names[scope];
+
+        for(int32_t parent = _netlist.scope_parents[scope]; parent >= 0; parent = _netlist.scope_parents[parent])
+        {
+            path = std::string(_netlist.scope_names[parent]) + "." + path;
+        }
+
+        return path;
+    }
+
+    bool selected(const std::string& scope, const std::string& name) const
+    {
+        bool in_scope = false, is_signal = false;
+
+        for(const std::string& pattern : _options.scopes) in_scope = in_scope || globMatch(pattern.c_str(), scope.c_str());
+        for(const std::string& pattern : _options.signals) is_signal = is_signal || globMatch(pattern.c_str(), name.c_str());
+
+        return in_scope && is_signal;
+    }
+
+    void select()
+    {
+        std::vector<std::string> paths;
+        std::vector<int32_t> signal_of(_netlist.nets(), -1);
+
+        for(uint32_t scope = 0; scope < _netlist.scopes; scope++) paths.push_back(scopePath(scope));
+
+        _declarations.resize(_netlist.scopes);
+
+        auto add = [&](uint32_t net, uint32_t scope, const std::string& name)
+        {
+            if (scope >= paths.size() || !selected(paths[scope], name)) return;
+
+            if (signal_of[net] < 0)
+            {
+                signal_of[net] = int32_t(_nets.size());
+                _nets.push_back(net);
+                _codes.push_back(code(_nets.size() - 1));
+            }
+
+            _declarations[scope].push_back({ uint32_t(signal_of[net]), name });
+        };
+
+        for(uint32_t i = 0; i < _netlist.inputs; i++) add(i, 0, _netlist.input_names[i]);
+        for(uint32_t o = 0; o < _netlist.outputs; o++) add(_netlist.output_nets[o], 0, _netlist.output_names[o]);
+
+        for(uint32_t g = 0; g < _netlist.gates; g++)
+        {
+            if (_netlist.kinds[g] != CONST0)
+            {
+                add(_netlist.inputs + g, _netlist.gate_scopes[g], std::string(kindName(_netlist.kinds[g])) + std::to_string(_netlist.gate_ids[g]));
+            }
+        }
+    }
+
+    static std::string code(size_t index)
+    {
+        std::string code;
+
+        do
+        {
+            code.push_back(char('!' + index % 94));
+            index /= 94;
+        }
+        while (index);
+
+        return code;
+    }
+
+    void writeScope(uint32_t scope, const std::vector<std::vector<uint32_t>>& children)
+    {
+        std::fprintf(_file, "$scope module %s $end\n", _netlist.scope_names[scope]);
+
+        for(const Declaration& declaration : _declarations[scope])
+        {
+            std::fprintf(_file, "$var wire 1 %s %s $end\n", _codes[declaration.signal].c_str(), declaration.name.c_str());
+        }
+
+        for(uint32_t child : children[scope]) writeScope(child, children);
+
+        std::fprintf(_file, "$upscope $end\n");
+    }
+
+    void writeHeader()
+    {
+        std::vector<std::vector<uint32_t>> children(_netlist.scopes);
+        std::vector<bool> used(_netlist.scopes, false);
+
+        for(uint32_t scope = 0; scope < _netlist.scopes; scope++)
+        {
+            if (!_declarations[scope].empty())
+            {
+                for(int32_t s = int32_t(scope); s >= 0 && !used[s]; s = _netlist.scope_parents[s]) used[s] = true;
+            }
+        }
+
+        for(uint32_t scope = 1; scope < _netlist.scopes; scope++)
+        {
+            if (used[scope]) children[_netlist.scope_parents[scope]].push_back(scope);
+        }
+
+        std::fprintf(_file, "$version logic-schemes-compiler batch simulator $end\n$timescale 1ns $end\n");
+        if (_netlist.scopes) writeScope(0, children);
+        std::fprintf(_file, "$enddefinitions $end\n");
+    }
+
+    const Netlist& _netlist;
+    TraceOptions _options;
+    FILE* _file = nullptr;
+
+    std::vector<uint32_t> _nets;
+    std::vector<std::string> _codes;
+    std::vector<std::vector<Declaration>> _declarations;
+    std::vector<Word> _last;
+    std::vector<uint8_t> _known;
+    std::vector<Word> _changed;
+    std::atomic<uint64_t> _changes { 0 };
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _space;
+    std::vector<std::unique_ptr<Ring>> _rings;
+    std::thread _writer;
+    bool _done = false;
+    bool _failed = false;
+};
+
+}
@@ -13,29 +13,18 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 
+include(compiler.pri)
+
 SOURCES += \
-    general/block.cpp \
-    general/connection.cpp \
-    general/schema.cpp \
-    generator/generator.cpp \
-    main.cpp \
-    parser/fatalparseexception.cpp \
-    parser/parser.cpp \
-    parser/parserimpl.cpp
+    main.cpp
 
 HEADERS += \
     build/lib/logic_schemes_lib.hpp \
-    general/block.h \
-    general/connection.h \
-    general/schema.h \
-    generator/generator.h \
-    parser/fatalparseexception.h \
-    parser/parser.h \
-    parser/parserimpl.h \
     test/out/single_include.h
 
 DISTFILES += \
     .gitignore \
+    compiler.pri \
     readme.md \
     test/test.json \
     test/use.json
@@ -1,24 +1,258 @@
 #include <iostream>
 
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QThread>
+
+#include "analysis/reachability.h"
+#include "analysis/structuralhash.h"
+#include "batch/batchcompiler.h"
+#include "coverage/togglereport.h"
+#include "fault/faultsimulator.h"
 #include "parser/parser.h"
 #include "generator/generator.h"
+#include "profiler/profiler.h"
+#include "watcher/watcher.h"
+
+static bool runFaultSimulation(const QCommandLineParser& cli, const Parser& p)
+{
+    Netlist netlist(p.mainSchema(), p.schemas());
+
+    if (!netlist.isValid())
+    {
+        std::cout << "Fault simulation skipped: " << netlist.error().toStdString() << std::endl;
+        return false;
+    }
+
+    if (netlist.registerCount() > 0)
+    {
+        std::cout << "Fault simulation skipped: the design has registers" << std::endl;
+        return false;
+    }
+
+    QList<PatternBlock> patterns;
+
+    if (cli.isSet("patterns"))
+    {
+        QString error;
+
+        if (!FaultSimulator::readPatterns(cli.value("patterns"), netlist.inputCount(), patterns, &error))
+        {
+            std::cerr << error.toStdString() << std::endl;
+            return false;
+        }
+    }
+    else
+    {
+        patterns = FaultSimulator::randomPatterns(netlist.inputCount(), cli.value("random").toLongLong(), cli.value("seed").toUInt());
+    }
+
+    FaultSimulator simulator(netlist);
+    simulator.run(patterns, cli.value("jobs").toInt());
+    simulator.report(std::cout, cli.value("undetected").toInt());
+    return true;
+}
+
+static bool printToggleReport(const QString& path, const Parser& p, NetLayout layout)
+{
+    Netlist netlist(p.mainSchema(), p.schemas());
+    netlist.relayout(layout);
+    ToggleReport report(netlist);
+    QString error;
+
+    if (!netlist.isValid() || !report.read(path, &error))
+    {
+        std::cerr << (netlist.isValid() ? error : netlist.error()).toStdString() << std::endl;
+        return false;
+    }
+
+    report.print(std::cout);
+    return true;
+}
 
 int main(int argc, char *argv[])
 {
-    Parser p;
+    QCoreApplication app(argc, argv);
+    QCommandLineParser cli;
+
+    cli.setApplicationDescription("Logic schemes compiler");
+    cli.addHelpOption();
+    cli.addPositionalArgument("inputs", "Top-level schema files.", "[inputs...]");
+    cli.addOptions({
+        { { "o", "output" }, "Output directory.", "dir", "../test/out" },
+        { "main", "Use the schema with type <typename> as the main schema instead of the top-level file's.", "typename" },
+        { "time-report", "Print a per-file and per-phase time report." },
+        { "trace", "Write a Chrome trace-event JSON to <file>.", "file" },
+        { "watch", "Keep running and recompile changed files and their dependents." },
+        { "lazy", "Read only typename and IO of library schemas until the main schema uses them." },
+        { "no-dedup", "Emit a separate class for every schema even if it is structurally identical to another." },
+        { "static", "Also generate static_design.hpp: value-member classes with fixed-size port arrays." },
+        { "faults", "Run stuck-at fault simulation on the main schema and report coverage." },
+        { "patterns", "Fault-simulate the vectors in <file> (CSV or .bin) instead of random ones.", "file" },
+        { "random", "Number of random patterns for --faults.", "n", "4096" },
+        { "seed", "Seed for random patterns.", "n", "1" },
+        { "undetected", "List at most <n> undetected faults, -1 for all.", "n", "20" },
+        { "memoize", "Memoize the static classes of the listed schemas (comma-separated typenames, * for all).", "types" },
+        { "toggle-coverage", "Build the batch simulator with per-net toggle counters." },
+        { "toggle-report", "Print the toggle counts in <file>, written by the batch simulator, for the main schema.", "file" },
+        { "layout", "Gate order of the batch simulator: topological, level or dfs.", "layout", "dfs" },
+        { "lut", "Map the batch simulator's netlist to lookup tables of up to <k> inputs (2 to 6) for cycle-based simulation.", "k" },
+        { "manifest", "Compile every top-level file listed in <file>, one per line.", "file" },
+        { { "j", "jobs" }, "Compile up to <n> designs concurrently.", "n", QString::number(QThread::idealThreadCount()) }
+    });
+    cli.process(app);
 
-    if (p.parse("../test/test.json"))
+    QStringList inputs = cli.positionalArguments();
+
+    if (cli.isSet("manifest"))
     {
-        Generator g;
-        g.generate("../test/out", p.mainSchema(), p.schemas());
-        std::cout << "Compilation finished" << std::endl;
+        bool ok;
+        inputs.append(BatchCompiler::readManifest(cli.value("manifest"), &ok));
+
+        if (!ok)
+        {
+            std::cerr << "Cannot read manifest \"" << cli.value("manifest").toStdString() << "\"" << std::endl;
+            return 1;
+        }
+    }
+
+    QString input = inputs.isEmpty() ? "../test/test.json" : inputs.first();
+    GeneratorOptions options;
+    options.dedup = !cli.isSet("no-dedup");
+    options.static_backend = cli.isSet("static");
+    options.memoize = cli.value("memoize").split(',');
+    options.memoize.removeAll("");
+    options.toggle_coverage = cli.isSet("toggle-coverage");
+
+    bool layout_ok;
+    options.layout = Netlist::layoutOf(cli.value("layout"), &layout_ok);
+
+    if (!layout_ok)
+    {
+        std::cerr << "Unknown layout \"" << cli.value("layout").toStdString() << "\"" << std::endl;
+        return 1;
+    }
+
+    if (cli.isSet("lut"))
+    {
+        options.lut_size = cli.value("lut").toInt();
+
+        if (options.lut_size < 2 || options.lut_size > 6)
+        {
+            std::cerr << "LUT size must be from 2 to 6" << std::endl;
+            return 1;
+        }
+    }
+
+    Profiler::instance().setEnabled(cli.isSet("time-report") || cli.isSet("trace"));
+
+    if (cli.isSet("watch"))
+    {
+        Watcher watcher(input, cli.value("output"), cli.isSet("lazy"), options);
+        watcher.start();
+        return app.exec();
+    }
+
+    int result = 0;
+
+    if (inputs.size() > 1 || cli.isSet("manifest"))
+    {
+        BatchCompiler batch(cli.value("output"), cli.value("jobs").toInt(), cli.isSet("lazy"), options);
+        result = batch.compile(inputs) ? 0 : 1;
+        batch.printSummary(std::cout);
     }
     else
     {
-         std::cout << "Compilation aborted due to errors" << std::endl;
+        Parser p;
+        p.setLazy(cli.isSet("lazy"));
+        p.setMainSchema(cli.value("main"));
+
+        if (cli.isSet("toggle-report"))
+        {
+            result = p.parse(input) && printToggleReport(cli.value("toggle-report"), p, options.layout) ? 0 : 1;
+        }
+        else if (p.parse(input))
+        {
+            Reachability reachability(p.mainSchema(), p.schemas());
+            Generator g;
+            g.setOptions(options);
+
+            if (options.dedup)
+            {
+                ScopedTimer timer("dedup");
+                StructuralHash hash(reachability.reachable());
+                g.setRepresentatives(hash.representatives());
+
+                if (hash.duplicates() > 0)
+                {
+                    std::cout << "Merged " << hash.duplicates() << " structurally identical schema(s)" << std::endl;
+                }
+            }
+
+            g.generate(cli.value("output"), p.mainSchema(), reachability.reachable());
+
+            for(const QString& error : g.takeWriteErrors())
+            {
+                std::cerr << error.toStdString() << std::endl;
+                result = 1;
+            }
+
+            if (!g.simulationError().isEmpty())
+            {
+                std::cout << "Batch simulator not generated: " << g.simulationError().toStdString() << std::endl;
+            }
+
+            for(const QString& warning : g.memoizeWarnings())
+            {
+                std::cerr << warning.toStdString() << std::endl;
+            }
+
+            if (!g.mappingSummary().isEmpty())
+            {
+                std::cout << g.mappingSummary().toStdString() << std::endl;
+            }
+
+            if (cli.isSet("faults") && !runFaultSimulation(cli, p))
+            {
+                result = 1;
+            }
+
+            if (g.skippedFiles() > 0 || g.removedFiles() > 0)
+            {
+                std::cout << "Wrote " << g.writtenFiles() << " file(s), " << g.skippedFiles() << " up to date, removed "
+                          << g.removedFiles() << " stale file(s)" << std::endl;
+            }
+
+            if (g.savedLines() > 0)
+            {
+                std::cout << "Deduplication saved " << g.savedLines() << " generated line(s), "
+                          << g.savedBytes() << " byte(s)" << std::endl;
+            }
+
+            if (!reachability.unreachable().isEmpty())
+            {
+                std::cout << "Skipped " << reachability.unreachable().size() << " unreachable schema(s), "
+                          << reachability.skippedBytes(p.files()) << " byte(s)" << std::endl;
+            }
+
+            std::cout << "Compilation finished" << std::endl;
+        }
+        else
+        {
+            std::cout << "Compilation aborted due to errors" << std::endl;
+            result = 1;
+        }
+    }
+
+    if (cli.isSet("time-report"))
+    {
+        Profiler::instance().report(std::cerr);
+    }
+
+    if (cli.isSet("trace") && !Profiler::instance().writeTrace(cli.value("trace")))
+    {
+        std::cerr << "Cannot write trace file \"" << cli.value("trace").toStdString() << "\"" << std::endl;
     }
 
-    Q_UNUSED(argc);
-    Q_UNUSED(argv);
-    return 0;
+    return result;
 }
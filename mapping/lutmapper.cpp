@@ -0,0 +1,389 @@
+#include "lutmapper.h"
+
+#include "../profiler/profiler.h"
+
+#include <algorithm>
+
+const int LutMapper::_max_size = 6;
+const int LutMapper::_priority_cuts = 8;
+
+// Truth table of a cut's first leaf. Tables of cuts with fewer than six
+// leaves are repeated over all 64 bits.
+static const quint64 first_leaf = 0xaaaaaaaaaaaaaaaaull;
+
+LutMapper::LutMapper(const Netlist& netlist, int size):
+    _netlist(netlist),
+    _size(qBound(2, size, _max_size)),
+    _scratch(0),
+    _gates(0),
+    _depth(0)
+{
+    ScopedTimer timer("lut mapping");
+
+    build();
+
+    for(int node : _order)
+    {
+        enumerate(node);
+    }
+
+    cover();
+}
+
+LutMapper::~LutMapper()
+{
+}
+
+int LutMapper::size() const
+{
+    return _size;
+}
+
+const QVector<Lut>& LutMapper::luts() const
+{
+    return _luts;
+}
+
+int LutMapper::scratchNets() const
+{
+    return _scratch;
+}
+
+int LutMapper::gateCount() const
+{
+    return _gates;
+}
+
+int LutMapper::depth() const
+{
+    return _depth;
+}
+
+double LutMapper::reduction() const
+{
+    return _gates == 0 ? 0.0 : 100.0 * (_gates - _luts.size()) / _gates;
+}
+
+QString LutMapper::summary() const
+{
+    return QString("LUT mapping: %1 gate(s) to %2 %3-LUT(s), %4% fewer nodes, depth %5")
+           .arg(_gates)
+           .arg(_luts.size())
+           .arg(_size)
+           .arg(reduction(), 0, 'f', 1)
+           .arg(_depth);
+}
+
+// Nodes are the netlist's nets followed by the inner nets of split gates.
+// Inputs and register outputs have no cuts of their own, so they are only
+// ever leaves.
+void LutMapper::build()
+{
+    int nets = _netlist.netCount();
+    QVector<QVector<int>> fanins(nets);
+
+    _kinds = QVector<GateKind>(nets, GateKind::CONST0);
+
+    for(int gate = 0; gate < _netlist.gateCount(); gate++)
+    {
+        int net = _netlist.net(gate);
+        GateKind kind = _netlist.kind(gate);
+        QVector<int> operands;
+
+        for(int pin = 0; pin < _netlist.faninCount(gate); pin++)
+        {
+            operands.append(_netlist.fanin(gate)[pin]);
+        }
+
+        _kinds[net] = kind;
+
+        if (kind == GateKind::REGISTER)
+        {
+            continue;
+        }
+
+        _gates++;
+
+        GateKind inner = kind == GateKind::AND || kind == GateKind::NAND ? GateKind::AND : GateKind::OR;
+
+        while (operands.size() > _size)
+        {
+            QVector<int> next;
+
+            for(int i = 0; i < operands.size(); i += _size)
+            {
+                if (operands.size() - i == 1)
+                {
+                    next.append(operands[i]);
+                    continue;
+                }
+
+                next.append(nets + _scratch++);
+                fanins.append(operands.mid(i, _size));
+                _kinds.append(inner);
+                _order.append(next.last());
+            }
+
+            operands = next;
+        }
+
+        fanins[net] = operands;
+        _order.append(net);
+    }
+
+    _offsets = QVector<int>(1, 0);
+    _fanouts = QVector<int>(fanins.size(), 0);
+
+    for(const QVector<int>& operands : fanins)
+    {
+        for(int operand : operands)
+        {
+            _fanin.append(operand);
+            _fanouts[operand]++;
+        }
+
+        _offsets.append(_fanin.size());
+    }
+
+    for(int output = 0; output < _netlist.outputCount(); output++)
+    {
+        _fanouts[_netlist.outputNet(output)]++;
+    }
+
+    _cuts = QVector<QVector<Cut>>(fanins.size());
+    _depths = QVector<int>(fanins.size(), 0);
+    _flows = QVector<float>(fanins.size(), 0);
+}
+
+// The cuts of a node are merged one fanin at a time from the cuts of its
+// fanins, each of which may also be taken as a leaf, keeping only the best
+// _priority_cuts partial cuts after every step. The cut of the fanins
+// themselves is always kept, so a node has at least one cut.
+void LutMapper::enumerate(int node)
+{
+    GateKind kind = _kinds[node];
+    bool conjunction = kind == GateKind::AND || kind == GateKind::NAND;
+    bool inverted = kind == GateKind::NOT || kind == GateKind::NAND || kind == GateKind::NOR;
+
+    Cut empty = {};
+    empty.table = conjunction ? ~quint64(0) : 0;
+    QVector<Cut> partial(1, empty);
+    Cut fanins = empty;
+
+    auto combine = [&](const Cut& left, const Cut& right)
+    {
+        Cut cut = merge(left, right);
+
+        if (cut.size <= _size)
+        {
+            quint64 a = stretch(left, cut), b = stretch(right, cut);
+            cut.table = conjunction ? a & b : a | b;
+        }
+
+        return cut;
+    };
+
+    auto same = [](const Cut& a, const Cut& b)
+    {
+        return a.size == b.size && std::equal(a.leaves, a.leaves + a.size, b.leaves);
+    };
+
+    for(int i = _offsets[node]; i < _offsets[node + 1]; i++)
+    {
+        int operand = _fanin[i];
+        QVector<Cut> choices = _cuts[operand];
+        QVector<Cut> next;
+
+        choices.append(trivial(operand));
+        fanins = combine(fanins, trivial(operand));
+
+        for(const Cut& left : partial)
+        {
+            for(const Cut& right : choices)
+            {
+                Cut cut = combine(left, right);
+
+                if (cut.size <= _size && std::none_of(next.begin(), next.end(), [&](const Cut& other) { return same(cut, other); }))
+                {
+                    next.append(cut);
+                }
+            }
+        }
+
+        std::sort(next.begin(), next.end(), [this](const Cut& a, const Cut& b) { return better(a, b); });
+        partial = next.mid(0, _priority_cuts);
+
+        if (std::none_of(partial.begin(), partial.end(), [&](const Cut& other) { return same(fanins, other); }))
+        {
+            partial.append(fanins);
+        }
+    }
+
+    for(Cut& cut : partial)
+    {
+        cut.table = inverted ? ~cut.table : cut.table;
+    }
+
+    _cuts[node] = partial;
+    _depths[node] = partial.first().depth;
+    _flows[node] = partial.first().flow / qMax(1, _fanouts[node]);
+}
+
+// Takes the best cut of every required node, starting from the outputs and
+// the register inputs, and makes its non-leaf inputs required.
+void LutMapper::cover()
+{
+    QVector<char> required(_kinds.size(), 0);
+
+    for(int output = 0; output < _netlist.outputCount(); output++)
+    {
+        required[_netlist.outputNet(output)] = 1;
+    }
+
+    for(int gate = 0; gate < _netlist.gateCount(); gate++)
+    {
+        if (_netlist.kind(gate) == GateKind::REGISTER)
+        {
+            required[_netlist.fanin(gate)[0]] = 1;
+        }
+    }
+
+    for(int i = _order.size() - 1; i >= 0; i--)
+    {
+        int node = _order[i];
+
+        if (required[node])
+        {
+            const Cut& best = _cuts[node].first();
+            std::for_each(best.leaves, best.leaves + best.size, [&required](int leaf) { required[leaf] = 1; });
+        }
+    }
+
+    for(int node : _order)
+    {
+        if (required[node])
+        {
+            const Cut& best = _cuts[node].first();
+            Lut lut = { node, QVector<int>(), best.table };
+
+            for(int i = 0; i < best.size; i++)
+            {
+                lut.leaves.append(best.leaves[i]);
+            }
+
+            _luts.append(lut);
+            _depth = qMax(_depth, best.depth);
+        }
+    }
+}
+
+// Unites the sorted leaves of two cuts and rates the result. A size above
+// _size means the cut is too large.
+LutMapper::Cut LutMapper::merge(const Cut& a, const Cut& b) const
+{
+    Cut cut = {};
+    int i = 0, j = 0;
+
+    while ((i < a.size || j < b.size) && cut.size <= _size)
+    {
+        int leaf;
+
+        if (j == b.size || (i < a.size && a.leaves[i] <= b.leaves[j]))
+        {
+            leaf = a.leaves[i++];
+            j += j < b.size && b.leaves[j] == leaf;
+        }
+        else
+        {
+            leaf = b.leaves[j++];
+        }
+
+        if (cut.size < _size)
+        {
+            cut.leaves[cut.size] = leaf;
+        }
+
+        cut.size++;
+    }
+
+    if (cut.size > _size)
+    {
+        return cut;
+    }
+
+    for(int k = 0; k < cut.size; k++)
+    {
+        cut.depth = qMax(cut.depth, _depths[cut.leaves[k]] + 1);
+        cut.flow += _flows[cut.leaves[k]];
+    }
+
+    cut.depth = qMax(cut.depth, 1);
+    cut.flow += 1;
+    return cut;
+}
+
+// Re-expresses the table of a cut over the leaves of a larger cut.
+quint64 LutMapper::stretch(const Cut& cut, const Cut& to) const
+{
+    if (cut.size == to.size)
+    {
+        return cut.table;
+    }
+
+    int position[6];
+
+    for(int i = 0, j = 0; i < cut.size; i++)
+    {
+        while (to.leaves[j] != cut.leaves[i])
+        {
+            j++;
+        }
+
+        position[i] = j;
+    }
+
+    quint64 table = 0;
+
+    for(int minterm = 0; minterm < (1 << to.size); minterm++)
+    {
+        int index = 0;
+
+        for(int i = 0; i < cut.size; i++)
+        {
+            index |= ((minterm >> position[i]) & 1) << i;
+        }
+
+        table |= ((cut.table >> index) & 1) << minterm;
+    }
+
+    for(int shift = to.size; shift < 6; shift++)
+    {
+        table |= table << (1 << shift);
+    }
+
+    return table;
+}
+
+LutMapper::Cut LutMapper::trivial(int node) const
+{
+    Cut cut = {};
+    cut.size = 1;
+    cut.leaves[0] = node;
+    cut.table = first_leaf;
+    return cut;
+}
+
+bool LutMapper::better(const Cut& a, const Cut& b) const
+{
+    if (a.flow != b.flow)
+    {
+        return a.flow < b.flow;
+    }
+
+    if (a.depth != b.depth)
+    {
+        return a.depth < b.depth;
+    }
+
+    return a.size < b.size;
+}
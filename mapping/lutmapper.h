@@ -0,0 +1,73 @@
+#ifndef LUTMAPPER_H
+#define LUTMAPPER_H
+
+#include "../netlist/netlist.h"
+
+struct Lut
+{
+    int net;
+    QVector<int> leaves;
+    quint64 table;
+};
+
+// Covers the gates of a netlist with k-input lookup tables. Every gate keeps
+// its best few cuts (priority cuts), ranked by area flow and then by depth,
+// since a simulator pays per table rather than per level, and the cover is
+// taken from the outputs and register inputs backwards. Gates with more
+// than k inputs are first split into trees of k-input gates, whose inner
+// nets are numbered after the netlist's nets.
+class LutMapper
+{
+private:
+    static const int _max_size;
+    static const int _priority_cuts;
+
+public:
+    LutMapper(const Netlist&, int size);
+    ~LutMapper();
+
+    int size() const;
+    const QVector<Lut>& luts() const;
+    int scratchNets() const;
+    int gateCount() const;
+    int depth() const;
+    double reduction() const;
+    QString summary() const;
+
+private:
+    struct Cut
+    {
+        quint8 size;
+        int leaves[6];
+        quint64 table;
+        int depth;
+        float flow;
+    };
+
+    void build();
+    void enumerate(int node);
+    void cover();
+    Cut merge(const Cut&, const Cut&) const;
+    quint64 stretch(const Cut&, const Cut&) const;
+    Cut trivial(int node) const;
+    bool better(const Cut&, const Cut&) const;
+
+private:
+    const Netlist& _netlist;
+    int _size;
+    int _scratch;
+    int _gates;
+    int _depth;
+
+    QVector<GateKind> _kinds;
+    QVector<int> _offsets;
+    QVector<int> _fanin;
+    QVector<int> _order;
+    QVector<int> _fanouts;
+    QVector<QVector<Cut>> _cuts;
+    QVector<int> _depths;
+    QVector<float> _flows;
+    QVector<Lut> _luts;
+};
+
+#endif // LUTMAPPER_H
@@ -0,0 +1,655 @@
+#include "netlist.h"
+
+#include "../analysis/structuralhash.h"
+#include "../profiler/profiler.h"
+
+#include <algorithm>
+
+Netlist::Netlist(const SharedPtr<Schema>& main_schema, const QMap<QString, SharedPtr<Schema>>& schemas):
+    _schemas(schemas),
+    _error(),
+    _offsets(1, 0),
+    _constant(-1),
+    _registers(0)
+{
+    ScopedTimer timer("flatten");
+    QVector<int> inputs;
+
+    // Buses are flattened to one primary input or output per bit.
+    auto bits = [](const QString& name, int width, QStringList& names)
+    {
+        for(int bit = 0; bit < width; bit++)
+        {
+            names.append(width == 1 ? name : name + "[" + QString::number(bit) + "]");
+        }
+    };
+
+    for(int i = 0; i < main_schema->inputs().size(); i++)
+    {
+        bits(main_schema->inputs()[i].second, main_schema->inputWidths().value(i, 1), _input_names);
+    }
+
+    for(int i = 0; i < main_schema->outputs().size(); i++)
+    {
+        bits(main_schema->outputs()[i].second, main_schema->outputWidths().value(i, 1), _output_names);
+    }
+
+    for(int i = 0; i < _input_names.size(); i++)
+    {
+        inputs.append(allocate());
+    }
+
+    _scopes.append(main_schema->typeName());
+    _scope_names.append(main_schema->typeName());
+    _scope_types.append(main_schema->typeName());
+    _scope_parents.append(-1);
+    _output_nets = flatten(main_schema, inputs, 0);
+
+    if (_error.isEmpty())
+    {
+        order();
+    }
+}
+
+Netlist::~Netlist()
+{
+}
+
+GateKind Netlist::kindOf(const QString& type_name)
+{
+    static const QMap<QString, GateKind> kinds =
+    {
+        { "Buffer", GateKind::BUFFER },
+        { "Not", GateKind::NOT },
+        { "And", GateKind::AND },
+        { "AndNot", GateKind::NAND },
+        { "Or", GateKind::OR },
+        { "OrNot", GateKind::NOR },
+        { "Register", GateKind::REGISTER }
+    };
+
+    return kinds.value(type_name, GateKind::CONST0);
+}
+
+const char* Netlist::kindName(GateKind kind)
+{
+    switch (kind)
+    {
+    case GateKind::CONST0: return "Const0";
+    case GateKind::BUFFER: return "Buffer";
+    case GateKind::NOT:    return "Not";
+    case GateKind::AND:    return "And";
+    case GateKind::NAND:   return "AndNot";
+    case GateKind::OR:     return "Or";
+    case GateKind::NOR:    return "OrNot";
+    case GateKind::REGISTER: return "Register";
+    }
+
+    return "";
+}
+
+NetLayout Netlist::layoutOf(const QString& name, bool* ok)
+{
+    static const QMap<QString, NetLayout> layouts =
+    {
+        { "topological", NetLayout::TOPOLOGICAL },
+        { "level", NetLayout::LEVEL },
+        { "dfs", NetLayout::DFS }
+    };
+
+    *ok = layouts.contains(name);
+    return layouts.value(name, NetLayout::DFS);
+}
+
+// Renumbers gates, and with them their output nets, in another topological
+// order. LEVEL groups gates by logic depth. DFS emits each output's fanin
+// cone in post-order, so a gate usually sits right after the gates that
+// drive it. Primary inputs keep nets 0 .. inputCount() - 1.
+void Netlist::relayout(NetLayout layout)
+{
+    if (!isValid() || layout == NetLayout::TOPOLOGICAL)
+    {
+        return;
+    }
+
+    ScopedTimer timer("layout");
+    int inputs = inputCount(), gates = gateCount();
+    QVector<int> order;
+    order.reserve(gates);
+
+    if (layout == NetLayout::LEVEL)
+    {
+        QVector<int> level(gates, 0);
+
+        for(int gate = 0; gate < gates; gate++)
+        {
+            order.append(gate);
+
+            for(int i = _offsets[gate]; i < _offsets[gate + 1] && _kinds[gate] != GateKind::REGISTER; i++)
+            {
+                if (_fanin[i] >= inputs)
+                {
+                    level[gate] = qMax(level[gate], level[_fanin[i] - inputs] + 1);
+                }
+            }
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return level[a] < level[b]; });
+    }
+    else
+    {
+        QVector<char> visited(gates, 0);
+        QVector<QPair<int, int>> stack;
+
+        auto visit = [&](int root)
+        {
+            if (root < 0 || visited[root])
+            {
+                return;
+            }
+
+            visited[root] = 1;
+            stack.append(qMakePair(root, _offsets[root]));
+
+            while (!stack.isEmpty())
+            {
+                int gate = stack.last().first;
+                int next = stack.last().second++;
+
+                // A register's value does not depend on its input within a
+                // cycle, so the walk stops there; its input cone is visited
+                // as a root of its own.
+                if (next == _offsets[gate + 1] || _kinds[gate] == GateKind::REGISTER)
+                {
+                    order.append(gate);
+                    stack.removeLast();
+                }
+                else if (_fanin[next] >= inputs && !visited[_fanin[next] - inputs])
+                {
+                    visited[_fanin[next] - inputs] = 1;
+                    stack.append(qMakePair(_fanin[next] - inputs, _offsets[_fanin[next] - inputs]));
+                }
+            }
+        };
+
+        for(int net : _output_nets)
+        {
+            visit(net - inputs);
+        }
+
+        for(int gate = 0; gate < gates; gate++)
+        {
+            visit(gate);
+        }
+    }
+
+    QVector<int> renamed(inputs + gates);
+    QVector<GateKind> kinds;
+    QVector<int> offsets(1, 0), fanin, scopes;
+    QVector<ID> block_ids;
+    QStringList port_names;
+
+    for(int net = 0; net < inputs; net++)
+    {
+        renamed[net] = net;
+    }
+
+    for(int i = 0; i < order.size(); i++)
+    {
+        renamed[inputs + order[i]] = inputs + i;
+    }
+
+    for(int gate : order)
+    {
+        for(int i = _offsets[gate]; i < _offsets[gate + 1]; i++)
+        {
+            fanin.append(renamed[_fanin[i]]);
+        }
+
+        kinds.append(_kinds[gate]);
+        offsets.append(fanin.size());
+        scopes.append(_scopes_of[gate]);
+        block_ids.append(_block_ids[gate]);
+        port_names.append(_port_names[gate]);
+    }
+
+    for(int& net : _output_nets)
+    {
+        net = renamed[net];
+    }
+
+    _kinds = kinds;
+    _offsets = offsets;
+    _fanin = fanin;
+    _scopes_of = scopes;
+    _block_ids = block_ids;
+    _port_names = port_names;
+}
+
+bool Netlist::isValid() const
+{
+    return _error.isEmpty();
+}
+
+const QString& Netlist::error() const
+{
+    return _error;
+}
+
+int Netlist::inputCount() const
+{
+    return _input_names.size();
+}
+
+int Netlist::outputCount() const
+{
+    return _output_names.size();
+}
+
+int Netlist::gateCount() const
+{
+    return _kinds.size();
+}
+
+int Netlist::netCount() const
+{
+    return inputCount() + gateCount();
+}
+
+int Netlist::registerCount() const
+{
+    return _registers;
+}
+
+// Covers exactly what netlist.hpp numbers: the gates in their order with
+// their fanin nets and the output nets. Per-net data such as snapshots and
+// toggle counts is only valid for a netlist with the same hash.
+quint64 Netlist::hash() const
+{
+    quint64 hash = StructuralHash::mix(StructuralHash::mix(inputCount(), outputCount()), gateCount());
+
+    for(int gate = 0; gate < gateCount(); gate++)
+    {
+        hash = StructuralHash::mix(StructuralHash::mix(hash, quint64(kind(gate))), faninCount(gate));
+
+        for(int pin = 0; pin < faninCount(gate); pin++)
+        {
+            hash = StructuralHash::mix(hash, fanin(gate)[pin]);
+        }
+    }
+
+    for(int output = 0; output < outputCount(); output++)
+    {
+        hash = StructuralHash::mix(hash, outputNet(output));
+    }
+
+    return hash;
+}
+
+GateKind Netlist::kind(int gate) const
+{
+    return _kinds[gate];
+}
+
+int Netlist::faninCount(int gate) const
+{
+    return _offsets[gate + 1] - _offsets[gate];
+}
+
+const int* Netlist::fanin(int gate) const
+{
+    return _fanin.constData() + _offsets[gate];
+}
+
+int Netlist::net(int gate) const
+{
+    return inputCount() + gate;
+}
+
+int Netlist::outputNet(int output) const
+{
+    return _output_nets[output];
+}
+
+const QString& Netlist::inputName(int input) const
+{
+    return _input_names[input];
+}
+
+const QString& Netlist::outputName(int output) const
+{
+    return _output_names[output];
+}
+
+int Netlist::scope(int gate) const
+{
+    return _scopes_of[gate];
+}
+
+ID Netlist::blockId(int gate) const
+{
+    return _block_ids[gate];
+}
+
+const QStringList& Netlist::scopes() const
+{
+    return _scopes;
+}
+
+const QString& Netlist::scopeName(int scope) const
+{
+    return _scope_names[scope];
+}
+
+int Netlist::scopeParent(int scope) const
+{
+    return _scope_parents[scope];
+}
+
+const QString& Netlist::scopeType(int scope) const
+{
+    return _scope_types[scope];
+}
+
+const QString& Netlist::portName(int gate) const
+{
+    return _port_names[gate];
+}
+
+QString Netlist::netName(int net) const
+{
+    if (net < inputCount())
+    {
+        return _scopes.first() + "." + _input_names[net];
+    }
+
+    int gate = net - inputCount();
+    return _scopes[_scopes_of[gate]] + "." + kindName(_kinds[gate]) + QString::number(_block_ids[gate]);
+}
+
+QVector<int> Netlist::flatten(const SharedPtr<Schema>& schema, const QVector<int>& inputs, int scope)
+{
+    const NetGraph& graph = schema->graph();
+    QVector<int> outputs(graph.outputPinCount());
+    QVector<int> pins(graph.inputPinCount());
+
+    if (schema->isInterface())
+    {
+        _error = "Schema \"" + schema->typeName() + "\" was not parsed completely";
+    }
+
+    for(int pin = 0; pin < outputs.size(); pin++)
+    {
+        outputs[pin] = allocate();
+    }
+
+    for(int pin = 0; pin < pins.size(); pin++)
+    {
+        int driver = graph.driver(pin);
+        pins[pin] = driver == -1 ? -1 : outputs[driver];
+    }
+
+    for(int i = 0; i < graph.globalInputs().size() && i < inputs.size(); i++)
+    {
+        pins[graph.globalInputs()[i]] = inputs[i];
+    }
+
+    for(int pin = 0; pin < pins.size(); pin++)
+    {
+        if (pins[pin] == -1)
+        {
+            pins[pin] = constant();
+        }
+    }
+
+    for(int block = 0; block < graph.blockCount() && _error.isEmpty(); block++)
+    {
+        ID id = graph.id(block);
+        SharedPtr<Block> b = schema->blocks().value(id);
+        QVector<int> fanin;
+
+        int first = graph.inputPinCount(block) > 0 ? graph.inputPin(block, 0) : 0;
+
+        for(int pin = first; pin < first + graph.inputPinCount(block); pin++)
+        {
+            fanin.append(pins[pin]);
+        }
+
+        if (b->type() != BlockType::CUSTOM)
+        {
+            // A bus primitive becomes one gate per bit; its ports are equally
+            // wide, so bit `bit` of port `port` is fanin[port * width + bit].
+            int width = graph.outputWidth(block, 0);
+
+            for(int bit = 0; bit < width; bit++)
+            {
+                QVector<int> bit_fanin;
+
+                for(int port = 0; port < graph.inputCount(block); port++)
+                {
+                    bit_fanin.append(fanin[port * width + bit]);
+                }
+
+                addGate(kindOf(b->typeName()), outputs[graph.outputPin(block, 0) + bit], bit_fanin, scope, id,
+                        width == 1 ? b->outputs().value(0) : b->outputs().value(0) + "[" + QString::number(bit) + "]");
+            }
+        }
+        else if (!_schemas.contains(b->typeName()))
+        {
+            _error = "Schema \"" + b->typeName() + "\" is not available";
+        }
+        else
+        {
+            _scopes.append(_scopes[scope] + "." + b->typeName() + QString::number(id));
+            _scope_names.append(b->typeName() + QString::number(id));
+            _scope_types.append(b->typeName());
+            _scope_parents.append(scope);
+            QVector<int> child = flatten(_schemas.value(b->typeName()), fanin, _scopes.size() - 1);
+
+            int first_output = graph.outputPinCount(block) > 0 ? graph.outputPin(block, 0) : 0;
+
+            for(int bit = 0; bit < child.size() && bit < graph.outputPinCount(block); bit++)
+            {
+                _alias[outputs[first_output + bit]] = child[bit];
+            }
+        }
+    }
+
+    QVector<int> result;
+
+    for(int pin : graph.globalOutputs())
+    {
+        result.append(outputs[pin]);
+    }
+
+    return result;
+}
+
+void Netlist::addGate(GateKind kind, int net, const QVector<int>& fanin, int scope, ID id, const QString& port)
+{
+    _kinds.append(kind);
+    _raw_nets.append(net);
+    _fanin.append(fanin);
+    _offsets.append(_fanin.size());
+    _scopes_of.append(scope);
+    _block_ids.append(id);
+    _port_names.append(port);
+}
+
+int Netlist::allocate()
+{
+    _alias.append(-1);
+    return _alias.size() - 1;
+}
+
+int Netlist::constant()
+{
+    if (_constant == -1)
+    {
+        _constant = allocate();
+        addGate(GateKind::CONST0, _constant, {}, 0, 0, QString());
+    }
+
+    return _constant;
+}
+
+int Netlist::resolve(int net)
+{
+    int root = net;
+
+    while (_alias[root] != -1)
+    {
+        root = _alias[root];
+    }
+
+    while (_alias[net] != -1)
+    {
+        int next = _alias[net];
+        _alias[net] = root;
+        net = next;
+    }
+
+    return root;
+}
+
+void Netlist::order()
+{
+    ScopedTimer timer("levelize");
+
+    int gates = _kinds.size();
+    QVector<int> producer(_alias.size(), -1);
+    QVector<int> pending(gates, 0);
+    QVector<int> offsets(gates + 1, 0);
+
+    for(int gate = 0; gate < gates; gate++)
+    {
+        producer[_raw_nets[gate]] = gate;
+    }
+
+    for(int& net : _fanin)
+    {
+        net = resolve(net);
+    }
+
+    // A register holds its value for the whole cycle and is latched after
+    // all other gates, so its input does not order it after the driver.
+    auto sequential = [&](int gate) { return _kinds[gate] == GateKind::REGISTER; };
+
+    for(int gate = 0; gate < gates; gate++)
+    {
+        _registers += sequential(gate) ? 1 : 0;
+
+        for(int i = _offsets[gate]; i < _offsets[gate + 1] && !sequential(gate); i++)
+        {
+            int source = producer[_fanin[i]];
+
+            if (source != -1)
+            {
+                pending[gate]++;
+                offsets[source + 1]++;
+            }
+        }
+    }
+
+    for(int gate = 0; gate < gates; gate++)
+    {
+        offsets[gate + 1] += offsets[gate];
+    }
+
+    QVector<int> fill = offsets, sinks(offsets.last());
+
+    for(int gate = 0; gate < gates; gate++)
+    {
+        for(int i = _offsets[gate]; i < _offsets[gate + 1] && !sequential(gate); i++)
+        {
+            int source = producer[_fanin[i]];
+
+            if (source != -1)
+            {
+                sinks[fill[source]++] = gate;
+            }
+        }
+    }
+
+    QVector<int> queue;
+    queue.reserve(gates);
+
+    for(int gate = 0; gate < gates; gate++)
+    {
+        if (pending[gate] == 0)
+        {
+            queue.append(gate);
+        }
+    }
+
+    for(int head = 0; head < queue.size(); head++)
+    {
+        int gate = queue[head];
+
+        for(int i = offsets[gate]; i < offsets[gate + 1]; i++)
+        {
+            if (--pending[sinks[i]] == 0)
+            {
+                queue.append(sinks[i]);
+            }
+        }
+    }
+
+    if (queue.size() != gates)
+    {
+        for(int gate = 0; gate < gates; gate++)
+        {
+            if (pending[gate] != 0)
+            {
+                _error = "Combinational loop through block with id = " + QString::number(_block_ids[gate])
+                        + " in \"" + _scopes[_scopes_of[gate]] + "\"";
+                return;
+            }
+        }
+    }
+
+    QVector<int> final_net(_alias.size(), -1);
+
+    for(int i = 0; i < inputCount(); i++)
+    {
+        final_net[i] = i;
+    }
+
+    for(int i = 0; i < gates; i++)
+    {
+        final_net[_raw_nets[queue[i]]] = inputCount() + i;
+    }
+
+    QVector<GateKind> kinds;
+    QVector<int> gate_offsets(1, 0), fanin, scopes;
+    QVector<ID> block_ids;
+    QStringList port_names;
+
+    for(int gate : queue)
+    {
+        for(int i = _offsets[gate]; i < _offsets[gate + 1]; i++)
+        {
+            fanin.append(final_net[_fanin[i]]);
+        }
+
+        kinds.append(_kinds[gate]);
+        gate_offsets.append(fanin.size());
+        scopes.append(_scopes_of[gate]);
+        block_ids.append(_block_ids[gate]);
+        port_names.append(_port_names[gate]);
+    }
+
+    for(int& net : _output_nets)
+    {
+        net = final_net[resolve(net)];
+    }
+
+    _kinds = kinds;
+    _offsets = gate_offsets;
+    _fanin = fanin;
+    _scopes_of = scopes;
+    _block_ids = block_ids;
+    _port_names = port_names;
+    _raw_nets = QVector<int>();
+    _alias = QVector<int>();
+}
@@ -0,0 +1,99 @@
+#ifndef NETLIST_H
+#define NETLIST_H
+
+#include "../general/schema.h"
+
+#include <QVector>
+
+enum class GateKind : quint8
+{
+    CONST0,
+    BUFFER,
+    NOT,
+    AND,
+    NAND,
+    OR,
+    NOR,
+    REGISTER
+};
+
+enum class NetLayout : quint8
+{
+    TOPOLOGICAL,
+    LEVEL,
+    DFS
+};
+
+class Netlist
+{
+public:
+    Netlist(const SharedPtr<Schema>&, const QMap<QString, SharedPtr<Schema>>&);
+    ~Netlist();
+
+    static GateKind kindOf(const QString&);
+    static const char* kindName(GateKind);
+    static NetLayout layoutOf(const QString&, bool* ok);
+
+    void relayout(NetLayout);
+
+    bool isValid() const;
+    const QString& error() const;
+
+    int inputCount() const;
+    int outputCount() const;
+    int gateCount() const;
+    int netCount() const;
+    int registerCount() const;
+    quint64 hash() const;
+
+    GateKind kind(int gate) const;
+    int faninCount(int gate) const;
+    const int* fanin(int gate) const;
+    int net(int gate) const;
+    int outputNet(int output) const;
+    const QString& inputName(int input) const;
+    const QString& outputName(int output) const;
+
+    int scope(int gate) const;
+    ID blockId(int gate) const;
+    const QStringList& scopes() const;
+    const QString& scopeName(int scope) const;
+    int scopeParent(int scope) const;
+    const QString& scopeType(int scope) const;
+    const QString& portName(int gate) const;
+    QString netName(int net) const;
+
+private:
+    QVector<int> flatten(const SharedPtr<Schema>&, const QVector<int>&, int scope);
+    void addGate(GateKind, int net, const QVector<int>&, int scope, ID, const QString& port);
+    int allocate();
+    int constant();
+    int resolve(int);
+    void order();
+
+private:
+    QMap<QString, SharedPtr<Schema>> _schemas;
+    QString _error;
+
+    QStringList _input_names;
+    QStringList _output_names;
+    QVector<int> _output_nets;
+
+    QVector<GateKind> _kinds;
+    QVector<int> _offsets;
+    QVector<int> _fanin;
+    QVector<int> _scopes_of;
+    QVector<ID> _block_ids;
+    QStringList _port_names;
+    QStringList _scopes;
+    QStringList _scope_names;
+    QStringList _scope_types;
+    QVector<int> _scope_parents;
+
+    QVector<int> _raw_nets;
+    QVector<int> _alias;
+    int _constant;
+    int _registers;
+};
+
+#endif // NETLIST_H
@@ -0,0 +1,281 @@
+#include "expression.h"
+
+#include <cmath>
+#include <limits>
+
+const int Expression::_max_depth = 64;
+
+Expression::Expression(const QString& text, const QMap<QString, qint64>& scope):
+    _text(text),
+    _scope(scope),
+    _error(),
+    _position(0),
+    _depth(0)
+{
+}
+
+Expression::~Expression()
+{
+}
+
+bool Expression::evaluate(qint64* value)
+{
+    *value = sum();
+    skipSpaces();
+
+    if (_error.isEmpty() && _position < _text.size())
+    {
+        fail("unexpected \"" + _text.mid(_position, 1) + "\"");
+    }
+
+    return _error.isEmpty();
+}
+
+const QString& Expression::error() const
+{
+    return _error;
+}
+
+bool Expression::isName(const QString& name)
+{
+    if (name.isEmpty() || name[0].isDigit())
+    {
+        return false;
+    }
+
+    for(QChar c : name)
+    {
+        if (!c.isLetterOrNumber() && c != '_')
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// JSON numbers are doubles; only whole ones that fit in qint64 are accepted.
+bool Expression::toInteger(double value, qint64* result)
+{
+    if (std::trunc(value) != value || value < -9223372036854775808.0 || value >= 9223372036854775808.0)
+    {
+        return false;
+    }
+
+    *result = qint64(value);
+    return true;
+}
+
+// Checked arithmetic: false if the exact result does not fit in qint64.
+bool Expression::checkedAdd(qint64 a, qint64 b, qint64* result)
+{
+    if ((b > 0 && a > std::numeric_limits<qint64>::max() - b) || (b < 0 && a < std::numeric_limits<qint64>::min() - b))
+    {
+        return false;
+    }
+
+    *result = a + b;
+    return true;
+}
+
+bool Expression::checkedSubtract(qint64 a, qint64 b, qint64* result)
+{
+    if ((b < 0 && a > std::numeric_limits<qint64>::max() + b) || (b > 0 && a < std::numeric_limits<qint64>::min() + b))
+    {
+        return false;
+    }
+
+    *result = a - b;
+    return true;
+}
+
+bool Expression::checkedMultiply(qint64 a, qint64 b, qint64* result)
+{
+    const qint64 max = std::numeric_limits<qint64>::max();
+    const qint64 min = std::numeric_limits<qint64>::min();
+
+    if (a > 0 ? (b > 0 ? a > max / b : b < min / a) : (b > 0 ? a < min / b : a != 0 && b < max / a))
+    {
+        return false;
+    }
+
+    *result = a * b;
+    return true;
+}
+
+qint64 Expression::sum()
+{
+    qint64 value = product();
+
+    while (_error.isEmpty())
+    {
+        skipSpaces();
+
+        if (_position < _text.size() && (_text[_position] == '+' || _text[_position] == '-'))
+        {
+            bool add = _text[_position++] == '+';
+            qint64 right = product();
+
+            if (!(add ? checkedAdd(value, right, &value) : checkedSubtract(value, right, &value)))
+            {
+                fail("integer overflow");
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return value;
+}
+
+qint64 Expression::product()
+{
+    qint64 value = unary();
+
+    while (_error.isEmpty())
+    {
+        skipSpaces();
+
+        if (_position < _text.size() && (_text[_position] == '*' || _text[_position] == '/' || _text[_position] == '%'))
+        {
+            QChar op = _text[_position++];
+            qint64 right = unary();
+
+            if (op == '*')
+            {
+                if (!checkedMultiply(value, right, &value))
+                {
+                    fail("integer overflow");
+                }
+            }
+            else if (right == 0)
+            {
+                fail("division by zero");
+            }
+            else if (right == -1 && value == std::numeric_limits<qint64>::min())
+            {
+                fail("integer overflow");
+            }
+            else
+            {
+                value = op == '/' ? value / right : value % right;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return value;
+}
+
+qint64 Expression::unary()
+{
+    skipSpaces();
+
+    if (_position < _text.size() && _text[_position] == '-')
+    {
+        if (++_depth > _max_depth)
+        {
+            fail("nested too deeply");
+            return 0;
+        }
+
+        _position++;
+        qint64 value = unary();
+        _depth--;
+
+        if (!checkedSubtract(0, value, &value))
+        {
+            fail("integer overflow");
+        }
+
+        return value;
+    }
+
+    return primary();
+}
+
+qint64 Expression::primary()
+{
+    skipSpaces();
+
+    if (_position >= _text.size())
+    {
+        fail("unexpected end");
+        return 0;
+    }
+
+    if (_text[_position] == '(')
+    {
+        if (++_depth > _max_depth)
+        {
+            fail("nested too deeply");
+            return 0;
+        }
+
+        _position++;
+        qint64 value = sum();
+        skipSpaces();
+
+        if (_error.isEmpty() && (_position >= _text.size() || _text[_position++] != ')'))
+        {
+            fail("missing \")\"");
+        }
+
+        _depth--;
+        return value;
+    }
+
+    int start = _position;
+
+    while (_position < _text.size() && (_text[_position].isLetterOrNumber() || _text[_position] == '_'))
+    {
+        _position++;
+    }
+
+    QString token = _text.mid(start, _position - start);
+    bool number = false;
+    qint64 value = token.toLongLong(&number);
+
+    if (number)
+    {
+        return value;
+    }
+
+    if (!isName(token))
+    {
+        fail(token.isEmpty() ? "unexpected \"" + _text.mid(_position, 1) + "\"" : "invalid number \"" + token + "\"");
+        return 0;
+    }
+
+    if (!_scope.contains(token))
+    {
+        fail("unknown name \"" + token + "\"");
+        return 0;
+    }
+
+    return _scope.value(token);
+}
+
+void Expression::skipSpaces()
+{
+    while (_position < _text.size() && _text[_position].isSpace())
+    {
+        _position++;
+    }
+}
+
+bool Expression::fail(const QString& error)
+{
+    if (_error.isEmpty())
+    {
+        _error = error;
+    }
+
+    _position = _text.size();
+    return false;
+}
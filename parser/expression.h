@@ -0,0 +1,45 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <QMap>
+#include <QString>
+
+// Integer expression in a parameterised schema: decimal numbers, names of
+// parameters and loop indexes, + - * / %, unary minus and parentheses.
+class Expression
+{
+private:
+    static const int _max_depth;
+
+public:
+    Expression(const QString&, const QMap<QString, qint64>&);
+    ~Expression();
+
+    bool evaluate(qint64*);
+    const QString& error() const;
+
+    static bool isName(const QString&);
+    static bool toInteger(double, qint64*);
+
+private:
+    qint64 sum();
+    qint64 product();
+    qint64 unary();
+    qint64 primary();
+
+    void skipSpaces();
+    bool fail(const QString&);
+
+    static bool checkedAdd(qint64, qint64, qint64*);
+    static bool checkedSubtract(qint64, qint64, qint64*);
+    static bool checkedMultiply(qint64, qint64, qint64*);
+
+private:
+    const QString _text;
+    const QMap<QString, qint64>& _scope;
+    QString _error;
+    int _position;
+    int _depth;
+};
+
+#endif // EXPRESSION_H
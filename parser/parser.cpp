@@ -1,5 +1,7 @@
 #include "parser.h"
 
+#include "../profiler/profiler.h"
+
 #include <QFile>
 #include <QDir>
 #include <QFileInfo>
@@ -13,7 +15,8 @@
 #include <iostream>
 
 Parser::Parser():
-    _has_error(false)
+    _has_error(false),
+    _lazy(false)
 {   
 }
 
@@ -21,59 +24,399 @@ Parser::~Parser()
 {
 }
 
+struct Parser::Frame
+{
+    QString path;
+    bool dependencies_only = false;
+    bool imported = false;
+    std::unique_ptr<ParserImpl> impl;
+    QStringList dependencies;
+    int next = 0;
+    std::unique_ptr<ScopedTimer> timer;
+};
+
 bool Parser::parse(const QString& path)
 {
-    try
+    QFileInfo info(path);
+    QString absolute_path = info.absoluteFilePath();
+
+    for(const QString& file : QStringList(_failed.values()))
+    {
+        invalidate(file);
+    }
+
+    _failed.clear();
+    _has_error = false;
+
+    if (!_files.contains(absolute_path))
+    {
+        parseFile(absolute_path);
+    }
+
+    _main_schema = _main_type.isEmpty() ? _files.value(absolute_path) : _declared_schemas.value(_main_type);
+
+    if (!_main_schema && !_main_type.isEmpty())
     {
-        QFileInfo info(path);
-        QString absolute_path = info.absoluteFilePath();
+        _stack.push(absolute_path);
+        error("Main schema \"%1\" is not declared", { _main_type });
+        _stack.pop();
+    }
+
+    if (_lazy && _main_schema)
+    {
+        resolveInterfaces();
+    }
+
+    return !_has_error;
+}
+
+void Parser::setLazy(bool lazy)
+{
+    _lazy = lazy;
+}
+
+void Parser::setLibrary(const SharedPtr<const SchemaLibrary>& library)
+{
+    _library = library;
+}
 
-        if (!_stack.contains(absolute_path))
+void Parser::setDiagnosticHandler(const DiagnosticHandler& handler)
+{
+    _diagnostic_handler = handler;
+}
+
+void Parser::setMainSchema(const QString& type_name)
+{
+    _main_type = type_name;
+}
+
+bool Parser::isInterfaceOnly() const
+{
+    return _lazy && _stack.size() > 1;
+}
+
+bool Parser::parseDependencies(const QString& path)
+{
+    _has_error = false;
+    parseTree(QFileInfo(path).absoluteFilePath(), true);
+    return !_has_error;
+}
+
+void Parser::parseFile(const QString& absolute_path)
+{
+    parseTree(absolute_path, false);
+}
+
+// Walks the `using` graph depth-first with an explicit stack of open files,
+// so the depth of a `using` chain is not limited by the call stack. A file
+// is converted once every file it uses has been declared.
+void Parser::parseTree(const QString& absolute_path, bool dependencies_only)
+{
+    std::vector<Frame> frames;
+    enter(frames, absolute_path, dependencies_only);
+
+    while (!frames.empty())
+    {
+        Frame& frame = frames.back();
+
+        if (frame.next == frame.dependencies.size())
+        {
+            leave(frames);
+            continue;
+        }
+
+        QString dependency = frame.dependencies[frame.next++];
+        _dependencies[frame.path].append(dependency);
+
+        if (!_open.contains(dependency) && !_files.contains(dependency))
         {
-            ParserImpl impl(this);
-            _stack.push(absolute_path);
-            impl.parse(absolute_path);
-            _stack.pop();
+            enter(frames, dependency, false);
         }
     }
-    catch (FatalParseException& e)
+}
+
+void Parser::enter(std::vector<Frame>& frames, const QString& path, bool dependencies_only)
+{
+    Frame frame;
+    frame.path = path;
+    frame.dependencies_only = dependencies_only;
+
+    if (!dependencies_only)
     {
-        error("Compilation aborted:\nFatal error", {});
+        _dependencies.insert(path, {});
     }
 
-    return !_has_error;
+    _stack.push(path);
+    _open.insert(path);
+
+    // A library built with --lazy holds interface-only schemas, which can
+    // only stand in for a file that is itself parsed for its interface.
+    SharedPtr<Schema> library_schema = !dependencies_only && _library ? _library->file(path) : nullptr;
+    frame.imported = library_schema && (!library_schema->isInterface() || isInterfaceOnly());
+    frame.timer.reset(new ScopedTimer(frame.imported ? "import" : "parse", QFileInfo(path).fileName()));
+
+    if (frame.imported)
+    {
+        frame.dependencies = _library->dependencies(path);
+    }
+    else
+    {
+        frame.impl.reset(new ParserImpl(this));
+
+        try
+        {
+            frame.dependencies = frame.impl->open(path, dependencies_only);
+        }
+        catch (FatalParseException& e)
+        {
+            error("Compilation aborted:\nFatal error", {});
+            frame.impl.reset();
+        }
+    }
+
+    frames.push_back(std::move(frame));
 }
 
-void Parser::error(QString error_template, const QStringList& args)
+void Parser::leave(std::vector<Frame>& frames)
 {
-    _has_error = true;
+    Frame& frame = frames.back();
 
-    for(const QString& argument : args)
+    if (frame.imported)
     {
-        error_template = error_template.arg(argument);
+        SharedPtr<Schema> schema = _library->file(frame.path);
+
+        if (!insert(schema))
+        {
+            error("Schema with type \"%1\" is already declared or default", { schema->typeName() });
+        }
+
+        for(const QString& instance : _library->instances(frame.path))
+        {
+            _declared_schemas.insert(instance, _library->schemas().value(instance));
+            _instances[frame.path].append(instance);
+        }
+    }
+    else if (frame.impl && !frame.dependencies_only)
+    {
+        try
+        {
+            frame.impl->parse();
+        }
+        catch (FatalParseException& e)
+        {
+            error("Compilation aborted:\nFatal error", {});
+        }
     }
 
-    for(int i = _stack.size() - 2; i >= 0; i--)
+    if (_dependencies.contains(frame.path))
+    {
+        _dependencies[frame.path].removeDuplicates();
+    }
+
+    _stack.pop();
+    _open.remove(frame.path);
+    frames.pop_back();
+}
+
+void Parser::resolveInterfaces()
+{
+    ScopedTimer timer("resolve");
+    QMap<QString, QString> sources;
+
+    for(auto it = _files.constBegin(); it != _files.constEnd(); ++it)
+    {
+        sources.insert(it.value()->typeName(), it.key());
+    }
+
+    QStringList queue = { _main_schema->typeName() };
+    QSet<QString> visited = { _main_schema->typeName() };
+
+    for(int i = 0; i < queue.size(); i++)
+    {
+        SharedPtr<Schema> schema = _declared_schemas.value(queue[i]);
+
+        if (schema && schema->isInterface())
+        {
+            QString path = sources.value(schema->typeName());
+            _files.remove(path);
+            _declared_schemas.remove(schema->typeName());
+            parseFile(path);
+            schema = _files.value(path);
+        }
+
+        if (!schema)
+        {
+            continue;
+        }
+
+        for(const SharedPtr<Block>& block : schema->blocks())
+        {
+            if (block->type() == BlockType::CUSTOM && !visited.contains(block->typeName()))
+            {
+                visited.insert(block->typeName());
+                queue.append(block->typeName());
+            }
+        }
+    }
+}
+
+QStringList Parser::invalidate(const QString& path)
+{
+    QStringList invalidated = { QFileInfo(path).absoluteFilePath() };
+
+    for(int i = 0; i < invalidated.size(); i++)
+    {
+        for(auto it = _dependencies.constBegin(); it != _dependencies.constEnd(); ++it)
+        {
+            if (it.value().contains(invalidated[i]) && !invalidated.contains(it.key()))
+            {
+                invalidated.append(it.key());
+            }
+        }
+    }
+
+    for(const QString& file : invalidated)
     {
-        error_template = "In file included from \"" + _stack[i] + "\":\n" + error_template;
+        SharedPtr<Schema> schema = _files.take(file);
+
+        if (schema)
+        {
+            _declared_schemas.remove(schema->typeName());
+        }
+
+        for(const QString& instance : _instances.take(file))
+        {
+            _declared_schemas.remove(instance);
+        }
+
+        _dependencies.remove(file);
     }
 
-    error_template = "Error in file \"" + _stack.top() + "\":\n" + error_template;
-    std::cerr << error_template.toStdString() << std::endl;
+    return invalidated;
+}
+
+void Parser::error(QString error_template, const QStringList& args)
+{
+    _has_error = true;
+    _failed.insert(_stack.top());
+    report(Diagnostic::Severity::ERROR, "Error", error_template, args);
+}
+
+void Parser::warning(QString warning_template, const QStringList& args)
+{
+    report(Diagnostic::Severity::WARNING, "Warning", warning_template, args);
+}
+
+void Parser::report(Diagnostic::Severity severity, const QString& kind, const QString& message_template, const QStringList& args)
+{
+    Diagnostic diagnostic { severity, _stack.top(), format(kind, message_template, args) };
+
+    if (_diagnostic_handler)
+    {
+        _diagnostic_handler(diagnostic);
+    }
+    else
+    {
+        std::cerr << diagnostic.message.toStdString() << std::endl;
+    }
 }
 
 bool Parser::insert(const SharedPtr<Schema>& schema)
 {
     if (!_declared_schemas.contains(schema->typeName()))
     {
-        _main_schema = schema;
+        _files.insert(_stack.top(), schema);
         _declared_schemas.insert(schema->typeName(), schema);
+        Profiler::instance().add(Counter::SCHEMAS, 1);
         return true;
     }
 
     return false;
 }
 
+// Instances are named after the schema and all of its parameter values,
+// e.g. "Adder_N16", and belong to the file that defines the schema: they
+// are dropped together with it, and so are all files that use them.
+QString Parser::instantiate(const QString& type_name, const QMap<QString, qint64>& arguments)
+{
+    SharedPtr<Schema> definition = _declared_schemas.value(type_name);
+    QMap<QString, qint64> parameters = definition ? definition->parameters() : QMap<QString, qint64>();
+
+    if (parameters.isEmpty())
+    {
+        error("Schema \"%1\" has no parameters", { type_name });
+        return QString();
+    }
+
+    QString name = type_name;
+
+    for(auto it = arguments.constBegin(); it != arguments.constEnd(); ++it)
+    {
+        if (!parameters.contains(it.key()))
+        {
+            error("Schema \"%1\" has no parameter \"%2\"", { type_name, it.key() });
+            return QString();
+        }
+
+        parameters.insert(it.key(), it.value());
+    }
+
+    if (parameters == definition->parameters())
+    {
+        return type_name;
+    }
+
+    for(auto it = parameters.constBegin(); it != parameters.constEnd(); ++it)
+    {
+        name += "_" + it.key() + (it.value() < 0 ? "m" + QString::number(-it.value()) : QString::number(it.value()));
+    }
+
+    QString source = _files.key(definition);
+
+    if (_instances.value(source).contains(name))
+    {
+        return name;
+    }
+
+    if (_declared_schemas.contains(name))
+    {
+        error("Instance \"%1\" of schema \"%2\" has the name of another schema", { name, type_name });
+        return QString();
+    }
+
+    if (_instantiating.contains(name))
+    {
+        error("Schema \"%1\" uses itself", { name });
+        return QString();
+    }
+
+    ScopedTimer timer("instantiate", name);
+    ParserImpl impl(this);
+    SharedPtr<Schema> schema;
+    _instantiating.insert(name);
+
+    try
+    {
+        schema = impl.instantiate(definition, parameters, name);
+    }
+    catch (FatalParseException& e)
+    {
+        error("Compilation aborted:\nFatal error", {});
+    }
+
+    _instantiating.remove(name);
+
+    if (!schema)
+    {
+        return QString();
+    }
+
+    _declared_schemas.insert(name, schema);
+    _instances[source].append(name);
+    Profiler::instance().add(Counter::SCHEMAS, 1);
+    return name;
+}
+
 const SharedPtr<Schema> Parser::mainSchema() const
 {
     return _main_schema;
@@ -84,3 +427,37 @@ const QMap<QString, SharedPtr<Schema>>& Parser::schemas() const
     return _declared_schemas;
 }
 
+const QMap<QString, SharedPtr<Schema>>& Parser::files() const
+{
+    return _files;
+}
+
+const QMap<QString, QStringList>& Parser::dependencies() const
+{
+    return _dependencies;
+}
+
+const QMap<QString, QStringList>& Parser::instances() const
+{
+    return _instances;
+}
+
+const QSet<QString>& Parser::failed() const
+{
+    return _failed;
+}
+
+QString Parser::format(const QString& kind, QString message_template, const QStringList& args) const
+{
+    for(const QString& argument : args)
+    {
+        message_template = message_template.arg(argument);
+    }
+
+    for(int i = _stack.size() - 2; i >= 0; i--)
+    {
+        message_template = "In file included from \"" + _stack[i] + "\":\n" + message_template;
+    }
+
+    return kind + " in file \"" + _stack.top() + "\":\n" + message_template;
+}
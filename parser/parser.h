@@ -2,9 +2,30 @@
 #define PARSER_H
 
 #include "parserimpl.h"
+#include "schemalibrary.h"
 
 #include <QStack>
 
+#include <functional>
+#include <vector>
+
+struct Diagnostic
+{
+    enum class Severity
+    {
+        ERROR,
+        WARNING
+    };
+
+    Severity severity;
+    QString file;
+    QString message;
+};
+
+using DiagnosticHandler = std::function<void(const Diagnostic&)>;
+
+// One compilation context. Parsers share nothing with each other except an
+// optional SchemaLibrary, so separate instances may run on separate threads.
 class Parser
 {
 public:
@@ -12,18 +33,52 @@ public:
     ~Parser();
 
     bool parse(const QString&);
+    bool parseDependencies(const QString&);
+    QStringList invalidate(const QString&);
+    void setLazy(bool);
+    void setLibrary(const SharedPtr<const SchemaLibrary>&);
+    void setDiagnosticHandler(const DiagnosticHandler&);
+    void setMainSchema(const QString& type_name);
+    bool isInterfaceOnly() const;
     void error(QString error_template, const QStringList&);
+    void warning(QString warning_template, const QStringList&);
 
     bool insert(const SharedPtr<Schema>&);
+    QString instantiate(const QString& type_name, const QMap<QString, qint64>&);
 
     const SharedPtr<Schema> mainSchema() const;
     const QMap<QString, SharedPtr<Schema>>& schemas() const;
+    const QMap<QString, SharedPtr<Schema>>& files() const;
+    const QMap<QString, QStringList>& dependencies() const;
+    const QMap<QString, QStringList>& instances() const;
+    const QSet<QString>& failed() const;
+
+private:
+    struct Frame;
+
+    void parseFile(const QString&);
+    void parseTree(const QString&, bool dependencies_only);
+    void enter(std::vector<Frame>&, const QString&, bool dependencies_only);
+    void leave(std::vector<Frame>&);
+    void report(Diagnostic::Severity, const QString&, const QString&, const QStringList&);
+    void resolveInterfaces();
+    QString format(const QString&, QString, const QStringList&) const;
 
 private:
     bool _has_error;
+    bool _lazy;
     QStack<QString> _stack;
+    QSet<QString> _open;
+    QString _main_type;
     SharedPtr<Schema> _main_schema;
+    SharedPtr<const SchemaLibrary> _library;
+    DiagnosticHandler _diagnostic_handler;
     QMap<QString, SharedPtr<Schema>> _declared_schemas;
+    QMap<QString, SharedPtr<Schema>> _files;
+    QMap<QString, QStringList> _dependencies;
+    QMap<QString, QStringList> _instances;
+    QSet<QString> _instantiating;
+    QSet<QString> _failed;
 };
 
 #endif // PARSER_H
@@ -1,10 +1,17 @@
 #include "parserimpl.h"
 
+#include "expression.h"
 #include "parser.h"
+#include "../profiler/profiler.h"
 
+#include <QAtomicInt>
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
+#include <QHash>
+#include <QSemaphore>
+#include <QSet>
+#include <QThreadPool>
 
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -50,8 +57,19 @@ const QStringList  ParserImpl::_multiphase_schema =
     "OrNot"
 };
 
+const QStringList  ParserImpl::_sequential_schema =
+{
+    "Register"
+};
+
+const int ParserImpl::_max_width = 65536;
+const qint64 ParserImpl::_max_repeat = 1 << 20;
+const int ParserImpl::_chunk_size = 4096;
+
 ParserImpl::ParserImpl(Parser* parser):
-    _parser(parser)
+    _parser(parser),
+    _decoded(false),
+    _parameterised(false)
 {
 }
 
@@ -59,16 +77,44 @@ ParserImpl::~ParserImpl()
 {
 }
 
-void ParserImpl::parse(const QString& path)
+// Reads the file and returns the absolute paths it uses. The rest of the
+// schema is converted by parse() once those files have been declared.
+QStringList ParserImpl::open(const QString& path, bool dependencies_only)
+{
+    QByteArray data = read(path);
+    _decoded = decode(data, _object);
+
+    if (!_decoded)
+    {
+        return {};
+    }
+
+    for(const QString& field : dependencies_only ? QStringList { "using" } : _schema_fields)
+    {
+        if (!_object.contains(field))
+        {
+            _parser->error("Schema does not contains property: \"%1\"", { field });
+            throw FatalParseException();
+        }
+    }
+
+    ScopedTimer timer("using");
+    QJsonValue _using = _object["using"];
+    return parseUsing(_using, QFileInfo(path).absoluteDir().absolutePath());
+}
+
+QByteArray ParserImpl::read(const QString& path)
 {
     QFile f(path);
     QFileInfo info(f);
 
     if (f.open(QIODevice::ReadOnly))
     {
+        ScopedTimer timer("read");
         QByteArray data = f.readAll();
         f.close();
-        parseJson(info.absoluteDir().absolutePath(), data);
+        Profiler::instance().add(Counter::BYTES_READ, data.size());
+        return data;
     }
     else
     {
@@ -77,109 +123,378 @@ void ParserImpl::parse(const QString& path)
     }
 }
 
-void ParserImpl::parseJson(const QString& path, const QByteArray& json)
+bool ParserImpl::decode(const QByteArray& json, QJsonObject& object)
 {
     QJsonParseError error;
-    QJsonDocument document = QJsonDocument::fromJson(json, &error);
+    QJsonDocument document;
+
+    {
+        ScopedTimer timer("decode");
+        document = QJsonDocument::fromJson(json, &error);
+    }
 
     if(error.error != QJsonParseError::NoError)
     {
         _parser->error("Invalid json: %1", { error.errorString() });
+        return false;
     }
     else if (!document.isObject())
     {
         _parser->error("Schema is not an object", {});
+        return false;
     }
-    else
+
+    object = document.object();
+    return true;
+}
+
+void ParserImpl::parse()
+{
+    if (_decoded)
     {
-        QJsonObject object = document.object();
-        QStringList fields = object.keys();
+        QJsonValue parameters = _object["parameters"];
+        SharedPtr<Schema> schema = convert(parseParameters(parameters), _parser->isInterfaceOnly());
 
-        for(const QString& field : _schema_fields)
+        if (schema)
         {
-            if(!fields.contains(field))
-            {
-                _parser->error("Schema does not contains property: \"%1\"", { field });
-                throw FatalParseException();
-            }
+            _parser->insert(schema);
         }
+    }
+}
+
+// Expands a parameterised schema with other parameter values under a new
+// type name. Instances are always parsed completely, also in lazy mode.
+SharedPtr<Schema> ParserImpl::instantiate(const SharedPtr<Schema>& definition, const QMap<QString, qint64>& parameters, const QString& type_name)
+{
+    _object = definition->definition();
+    _decoded = true;
+    _type_name = type_name;
+    return convert(parameters, false);
+}
+
+SharedPtr<Schema> ParserImpl::convert(const QMap<QString, qint64>& parameters, bool interface_only)
+{
+    QJsonValue inputs, outputs, blocks, connections;
+    QJsonValue type_name = _object["typename"];
+
+    _parameterised = _object.contains("parameters");
+    _scope = parameters;
 
-        QJsonValue _using = object["using"];
-        QJsonValue inputs = object["inputs"];
-        QJsonValue outputs = object["outputs"];
-        QJsonValue type_name = object["typename"];
-        QJsonValue blocks = object["blocks"];
-        QJsonValue connections = object["connections"];
+    {
+        ScopedTimer timer("expand");
+        inputs = expand(_object["inputs"]);
+        outputs = expand(_object["outputs"]);
+        blocks = expand(_object["blocks"]);
+        connections = interface_only ? QJsonValue() : expand(_object["connections"]);
+    }
 
-        parseUsing(_using, path);
+    SharedPtr<Schema> schema = std::make_shared<Schema>();
 
-        SharedPtr<Schema> schema = std::make_shared<Schema>();
+    if (_parameterised)
+    {
+        schema->setParameters(parameters);
+        schema->setDefinition(_object);
+    }
 
+    if (interface_only)
+    {
+        schema->setInputs(parseGlobalIO(inputs));
+        schema->setOutputs(parseGlobalIO(outputs));
+        schema->setInputWidths(parseInterfaceWidths(schema->inputs(), blocks, true));
+        schema->setOutputWidths(parseInterfaceWidths(schema->outputs(), blocks, false));
+        schema->setTypeName(_type_name.isEmpty() ? parseTypeName(type_name) : _type_name);
+        schema->setInterface(true);
+        return schema;
+    }
+
+    {
+        ScopedTimer timer("convert");
         schema->setInputs(parseGlobalIO(inputs));
         schema->setOutputs(parseGlobalIO(outputs));
         schema->setConnections(parseConnections(connections));
         schema->setBlocks(parseBlocks(blocks));
-        schema->setTypeName(parseTypeName(type_name));
+        schema->setTypeName(_type_name.isEmpty() ? parseTypeName(type_name) : _type_name);
+        Profiler::instance().add(Counter::BLOCKS, schema->blocks().size());
+        Profiler::instance().add(Counter::CONNECTIONS, schema->connections().size());
+    }
 
-        for(const QPair<ID, QString>& p : schema->inputs())
-        {
-            ID id = p.first;
-            QString name = p.second;
+    {
+        ScopedTimer timer("validate");
+        validate(schema);
+    }
+
+    return schema;
+}
 
-            if (!schema->blocks().contains(id))
+void ParserImpl::validate(const SharedPtr<Schema>& schema)
+{
+    NetGraph graph(schema->blocks());
+    QList<SharedPtr<Block>> blocks = schema->blocks().values();
+    QVector<QHash<QString, int>> input_ports(blocks.size()), output_ports(blocks.size());
+
+    // Port names are indexed up front, so a connection costs a hash lookup
+    // instead of a scan of the block's port list, and the indexes can be
+    // read from several threads.
+    forChunks(blocks.size(), [&](int begin, int end)
+    {
+        for(int block = begin; block < end; block++)
+        {
+            for(int i = 0; i < blocks.at(block)->inputs().size(); i++)
             {
-                _parser->error("Global input id = \"%1\" not found", {QString::number(id)});
+                input_ports[block].insert(blocks.at(block)->inputs()[i], i);
             }
-            else if (schema->blocks()[id]->inputs().indexOf(name) == -1)
+
+            for(int i = 0; i < blocks.at(block)->outputs().size(); i++)
             {
-                _parser->error("Global input name = \"%1\" not found", {name});
+                output_ports[block].insert(blocks.at(block)->outputs()[i], i);
             }
         }
+    });
+
+    auto port = [](const QHash<QString, int>& index, const QString& name)
+    {
+        return index.value(name, -1);
+    };
+
+    QVector<int> input_widths, output_widths;
 
-        for(const QPair<ID, QString>& p : schema->outputs())
+    for(const QPair<ID, QString>& p : schema->inputs())
+    {
+        ID id = p.first;
+        QString name = p.second;
+        int block = graph.index(id);
+        int port_index = block == -1 ? -1 : port(input_ports[block], name);
+
+        if (block == -1)
+        {
+            _parser->error("Global input id = \"%1\" not found", {QString::number(id)});
+            input_widths.append(1);
+        }
+        else if (port_index == -1)
+        {
+            _parser->error("Global input name = \"%1\" not found", {name});
+            input_widths.append(1);
+        }
+        else
         {
-            ID id = p.first;
-            QString name = p.second;
+            int pin = graph.inputPin(block, port_index);
+            input_widths.append(graph.inputWidth(block, port_index));
 
-            if (!schema->blocks().contains(id))
+            for(int bit = 0; bit < input_widths.last(); bit++)
             {
-                _parser->error("Global input id = \"%1\" not found", {QString::number(id)});
+                graph.addGlobalInput(pin + bit);
             }
-            else if (schema->blocks()[id]->outputs().indexOf(name) == -1)
+        }
+    }
+
+    for(const QPair<ID, QString>& p : schema->outputs())
+    {
+        ID id = p.first;
+        QString name = p.second;
+        int block = graph.index(id);
+        int port_index = block == -1 ? -1 : port(output_ports[block], name);
+
+        if (block == -1)
+        {
+            _parser->error("Global input id = \"%1\" not found", {QString::number(id)});
+            output_widths.append(1);
+        }
+        else if (port_index == -1)
+        {
+            _parser->error("Global input name = \"%1\" not found", {name});
+            output_widths.append(1);
+        }
+        else
+        {
+            int pin = graph.outputPin(block, port_index);
+            output_widths.append(graph.outputWidth(block, port_index));
+
+            for(int bit = 0; bit < output_widths.last(); bit++)
             {
-                _parser->error("Global input name = \"%1\" not found", {name});
+                graph.addGlobalOutput(pin + bit);
             }
         }
+    }
 
-        for(const SharedPtr<Connection> & connection : schema->connections())
+    schema->setInputWidths(input_widths);
+    schema->setOutputWidths(output_widths);
+
+    // Connections are checked in chunks; their diagnostics and pins are
+    // collected in source order, so the graph and the messages are the
+    // same as for a serial pass.
+    const QList<SharedPtr<Connection>>& connections = schema->connections();
+    QVector<Diagnostics> diagnostics(connections.size());
+    QVector<int> from(connections.size(), -1), to(connections.size(), -1);
+
+    forChunks(connections.size(), [&](int begin, int end)
+    {
+        for(int i = begin; i < end; i++)
         {
-            if (!schema->blocks().contains(connection->inputID()))
+            const SharedPtr<Connection>& connection = connections[i];
+            int input_block = graph.index(connection->inputID());
+            int output_block = graph.index(connection->outputID());
+            int input_port = -1, output_port = -1;
+
+            if (input_block == -1)
+            {
+                diagnostics[i].error("Block with id = %1 does not exists in \"%2\"", {QString::number(connection->inputID()), schema->typeName()});
+            }
+            else if ((input_port = port(input_ports.at(input_block), connection->inputName())) == -1)
+            {
+                diagnostics[i].error("Block with id = %1 does not contains input with name = \"%2\"",
+                                     { QString::number(connection->inputID()),connection->inputName()});
+            }
+
+            if (output_block == -1)
+            {
+                diagnostics[i].error("Block with id = %1 does not exists in \"%2\"", {QString::number(connection->outputID()), schema->typeName()});
+            }
+            else if ((output_port = port(output_ports.at(output_block), connection->outputName())) == -1)
+            {
+                diagnostics[i].error("Block with id = %1 does not contains input with name = \"%2\"",
+                                     { QString::number(connection->outputID()),connection->outputName()});
+            }
+
+            if (input_port == -1 || output_port == -1)
+            {
+                continue;
+            }
+
+            int input_width = graph.inputWidth(input_block, input_port);
+            int output_width = graph.outputWidth(output_block, output_port);
+
+            if (connection->inputWidth() == -1)
             {
-                _parser->error("Block with id = %1 does not exists in \"%2\"", {QString::number(connection->inputID()), schema->typeName()});
+                connection->setInputSlice(0, input_width);
             }
-            else if (!schema->blocks()[connection->inputID()]->inputs().contains(connection->inputName()))
+
+            if (connection->outputWidth() == -1)
             {
-                _parser->error("Block with id = %1 does not contains input with name = \"%2\"",
-                               { QString::number(connection->inputID()),connection->inputName()});
+                connection->setOutputSlice(0, output_width);
             }
 
-            if (!schema->blocks().contains(connection->outputID()))
+            if (connection->inputLsb() > input_width - connection->inputWidth())
             {
-                _parser->error("Block with id = %1 does not exists in \"%2\"", {QString::number(connection->outputID()), schema->typeName()});
+                diagnostics[i].error("Bits of input \"%1\" of block with id = %2 are out of range, it has %3 bit(s)",
+                                     { connection->inputName(), QString::number(connection->inputID()), QString::number(input_width) });
             }
-            else if (!schema->blocks()[connection->outputID()]->outputs().contains(connection->outputName()))
+            else if (connection->outputLsb() > output_width - connection->outputWidth())
             {
-                _parser->error("Block with id = %1 does not contains input with name = \"%2\"",
-                               { QString::number(connection->outputID()),connection->outputName()});
+                diagnostics[i].error("Bits of output \"%1\" of block with id = %2 are out of range, it has %3 bit(s)",
+                                     { connection->outputName(), QString::number(connection->outputID()), QString::number(output_width) });
             }
+            else if (connection->inputWidth() != connection->outputWidth())
+            {
+                diagnostics[i].error("Connection to input \"%1\" of block with id = %2 joins %3 bit(s) to %4 bit(s)",
+                                     { connection->inputName(), QString::number(connection->inputID()),
+                                       QString::number(connection->outputWidth()), QString::number(connection->inputWidth()) });
+            }
+            else
+            {
+                from[i] = graph.outputPin(output_block, output_port) + connection->outputLsb();
+                to[i] = graph.inputPin(input_block, input_port) + connection->inputLsb();
+            }
+        }
+    });
+
+    for(int i = 0; i < connections.size(); i++)
+    {
+        report(diagnostics[i]);
+
+        for(int bit = 0; from[i] != -1 && bit < connections[i]->inputWidth(); bit++)
+        {
+            graph.connect(from[i] + bit, to[i] + bit);
+        }
+    }
+
+    graph.build();
+
+    auto pin_name = [&](int pin)
+    {
+        int block = graph.inputBlock(pin), port = graph.inputPort(pin);
+        QString name = blocks.at(block)->inputs()[port];
+        return graph.inputWidth(block, port) == 1 ? name : name + "[" + QString::number(graph.inputBit(pin)) + "]";
+    };
+
+    for(int pin : graph.multipleDrivers())
+    {
+        ID id = graph.id(graph.inputBlock(pin));
+
+        _parser->error("Input \"%1\" of block with id = %2 has multiple drivers",
+                       { pin_name(pin), QString::number(id) });
+    }
+
+    for(int pin : graph.unconnectedInputs())
+    {
+        ID id = graph.id(graph.inputBlock(pin));
+
+        _parser->warning("Input \"%1\" of block with id = %2 is not connected",
+                         { pin_name(pin), QString::number(id) });
+    }
+
+    schema->setGraph(graph);
+}
+
+void ParserImpl::Diagnostics::error(const QString& message, const QStringList& args)
+{
+    errors.append(qMakePair(message, args));
+}
+
+// Runs work(begin, end) over [0, count) in chunks of _chunk_size elements.
+// The chunks go to the global thread pool, so parsers running side by side
+// (lsc --batch -j) share one set of threads instead of each starting its
+// own. The calling thread takes chunks too and only waits for the helpers
+// it started, never for other parsers' work.
+void ParserImpl::forChunks(int count, const std::function<void(int, int)>& work)
+{
+    QThreadPool* pool = QThreadPool::globalInstance();
+    int chunks = (count + _chunk_size - 1) / _chunk_size;
+    int helpers = qMin(chunks, pool->maxThreadCount()) - 1;
+
+    if (helpers <= 0)
+    {
+        work(0, count);
+        return;
+    }
+
+    QAtomicInt next(0);
+    QSemaphore done;
+
+    auto run = [&]()
+    {
+        for(int chunk = next.fetchAndAddRelaxed(1); chunk < chunks; chunk = next.fetchAndAddRelaxed(1))
+        {
+            int begin = chunk * _chunk_size;
+            work(begin, qMin(count, begin + _chunk_size));
         }
+    };
+
+    for(int i = 0; i < helpers; i++)
+    {
+        pool->start([&run, &done]() { run(); done.release(); });
+    }
+
+    run();
+    done.acquire(helpers);
+}
+
+void ParserImpl::report(const Diagnostics& diagnostics)
+{
+    for(const QPair<QString, QStringList>& error : diagnostics.errors)
+    {
+        _parser->error(error.first, error.second);
+    }
 
-        _parser->insert(schema);
+    if (diagnostics.fatal)
+    {
+        throw FatalParseException();
     }
 }
 
-void ParserImpl::parseUsing(QJsonValue& values, const QString& path)
+QStringList ParserImpl::parseUsing(QJsonValue& values, const QString& path)
 {
+    QStringList dependencies;
+
     if (!values.isArray())
     {
         _parser->error("Property \"using\" is not an array", {});
@@ -196,10 +511,261 @@ void ParserImpl::parseUsing(QJsonValue& values, const QString& path)
             }
             else
             {
-                _parser->parse(path + "/" + value.toString());
+                dependencies.append(QFileInfo(path + "/" + value.toString()).absoluteFilePath());
+            }
+        }
+    }
+
+    return dependencies;
+}
+
+QMap<QString, qint64> ParserImpl::parseParameters(QJsonValue& value)
+{
+    QMap<QString, qint64> parameters;
+
+    if (value.isUndefined())
+    {
+        return parameters;
+    }
+
+    if (!value.isObject())
+    {
+        _parser->error("Property \"parameters\" is not an object", {});
+        throw FatalParseException();
+    }
+
+    QJsonObject object = value.toObject();
+    qint64 integer;
+
+    for(auto it = object.constBegin(); it != object.constEnd(); ++it)
+    {
+        if (!Expression::isName(it.key()))
+        {
+            _parser->error("Parameter name \"%1\" is not a valid name", { it.key() });
+        }
+        else if (!it.value().isDouble() || !Expression::toInteger(it.value().toDouble(), &integer))
+        {
+            _parser->error("Default value of parameter \"%1\" is not an integer", { it.key() });
+        }
+        else
+        {
+            parameters.insert(it.key(), integer);
+        }
+    }
+
+    return parameters;
+}
+
+// Parameter values of a CUSTOM block select an instance of a parameterised
+// schema. Returns the instance's type name, or an empty string on errors.
+QString ParserImpl::parseArguments(const QString& type_name, QJsonValue& value)
+{
+    if (!value.isObject())
+    {
+        _parser->error("Property \"parameters\" of block is not an object", {});
+        return QString();
+    }
+
+    QJsonObject object = value.toObject();
+    QMap<QString, qint64> arguments;
+    qint64 integer;
+
+    for(auto it = object.constBegin(); it != object.constEnd(); ++it)
+    {
+        if (!it.value().isDouble() || !Expression::toInteger(it.value().toDouble(), &integer))
+        {
+            _parser->error("Value of parameter \"%1\" is not an integer", { it.key() });
+            return QString();
+        }
+
+        arguments.insert(it.key(), integer);
+    }
+
+    return _parser->instantiate(type_name, arguments);
+}
+
+// Unrolls the entries of an array that have "for", "from" and "to" (the
+// end is excluded) into one entry per index, and substitutes expressions.
+// Schemas without parameters are taken literally.
+QJsonValue ParserImpl::expand(const QJsonValue& value)
+{
+    if (!_parameterised || !value.isArray())
+    {
+        return value;
+    }
+
+    QJsonArray result;
+
+    for(const QJsonValue& item : value.toArray())
+    {
+        QJsonObject object = item.toObject();
+
+        if (!item.isObject() || !object.contains("for"))
+        {
+            result.append(substitute(item));
+            continue;
+        }
+
+        QString index = object["for"].toString();
+        qint64 from, to;
+
+        if (!Expression::isName(index) || _scope.contains(index))
+        {
+            _parser->error("Loop index \"%1\" is not a valid name or hides a parameter", { index });
+            continue;
+        }
+
+        if (!evaluate(object["from"], &from) || !evaluate(object["to"], &to))
+        {
+            continue;
+        }
+
+        // The difference of two qint64 values always fits in quint64.
+        if (to > from && quint64(to) - quint64(from) > quint64(_max_repeat))
+        {
+            _parser->error("Loop over \"%1\" has more than %2 iterations", { index, QString::number(_max_repeat) });
+            continue;
+        }
+
+        object.remove("for");
+        object.remove("from");
+        object.remove("to");
+
+        for(qint64 i = from; i < to; i++)
+        {
+            _scope.insert(index, i);
+            result.append(substitute(object));
+        }
+
+        _scope.remove(index);
+    }
+
+    return result;
+}
+
+// Replaces {expression} in strings, and expressions given as strings where
+// a number is expected: IDs and the parameter values of CUSTOM blocks.
+QJsonValue ParserImpl::substitute(const QJsonValue& value)
+{
+    static const QStringList numbers = { "id", "input-id", "output-id" };
+
+    if (value.isString())
+    {
+        return interpolate(value.toString());
+    }
+
+    if (value.isArray())
+    {
+        QJsonArray array;
+
+        for(const QJsonValue& item : value.toArray())
+        {
+            array.append(substitute(item));
+        }
+
+        return array;
+    }
+
+    if (value.isObject())
+    {
+        QJsonObject object = value.toObject();
+
+        for(auto it = object.begin(); it != object.end(); ++it)
+        {
+            qint64 number;
+
+            if (numbers.contains(it.key()) && it.value().isString())
+            {
+                it.value() = evaluate(it.value(), &number) ? QJsonValue(double(number)) : QJsonValue(-1);
+            }
+            else if (it.key() == "parameters" && it.value().isObject())
+            {
+                QJsonObject arguments = it.value().toObject();
+
+                for(auto argument = arguments.begin(); argument != arguments.end(); ++argument)
+                {
+                    if (argument.value().isString() && evaluate(argument.value(), &number))
+                    {
+                        argument.value() = double(number);
+                    }
+                }
+
+                it.value() = arguments;
+            }
+            else
+            {
+                it.value() = substitute(it.value());
             }
         }
+
+        return object;
+    }
+
+    return value;
+}
+
+QString ParserImpl::interpolate(const QString& text)
+{
+    if (!text.contains('{'))
+    {
+        return text;
+    }
+
+    QString result;
+    int position = 0;
+
+    while (position < text.size())
+    {
+        int open = text.indexOf('{', position);
+        int close = open == -1 ? -1 : text.indexOf('}', open);
+        qint64 value;
+
+        if (open == -1)
+        {
+            result += text.mid(position);
+            break;
+        }
+
+        if (close == -1)
+        {
+            _parser->error("Missing \"}\" in \"%1\"", { text });
+            return text;
+        }
+
+        if (!evaluate(text.mid(open + 1, close - open - 1), &value))
+        {
+            return text;
+        }
+
+        result += text.mid(position, open - position) + QString::number(value);
+        position = close + 1;
+    }
+
+    return result;
+}
+
+bool ParserImpl::evaluate(const QJsonValue& value, qint64* result)
+{
+    if (value.isDouble())
+    {
+        if (!Expression::toInteger(value.toDouble(), result))
+        {
+            _parser->error("Number %1 is not an integer", { QString::number(value.toDouble(), 'g', 17) });
+            return false;
+        }
+
+        return true;
+    }
+
+    Expression expression(value.toString(), _scope);
+
+    if (!value.isString() || !expression.evaluate(result))
+    {
+        _parser->error("Invalid expression \"%1\": %2", { value.toString(), value.isString() ? expression.error() : "not a number or string" });
+        return false;
     }
+
+    return true;
 }
 
 QList<QPair<ID, QString>> ParserImpl::parseGlobalIO(QJsonValue& value)
@@ -253,35 +819,107 @@ QList<QPair<ID, QString>> ParserImpl::parseGlobalIO(QJsonValue& value)
     }
 }
 
-QStringList ParserImpl::parseIO(QJsonValue& value)
+// Reads the widths of global IO from the blocks they refer to, without
+// converting the blocks, for schemas that are only parsed for their interface.
+QVector<int> ParserImpl::parseInterfaceWidths(const QList<QPair<ID, QString>>& ios, QJsonValue& value, bool inputs)
+{
+    QHash<ID, QJsonObject> objects;
+    QVector<int> widths;
+
+    for(const QPair<ID, QString>& io : ios)
+    {
+        objects.insert(io.first, QJsonObject());
+    }
+
+    for(const QJsonValue& block : value.toArray())
+    {
+        QJsonObject object = block.toObject();
+        ID id = object["id"].toInt(-1);
+
+        if (objects.contains(id))
+        {
+            objects.insert(id, object);
+        }
+    }
+
+    for(const QPair<ID, QString>& io : ios)
+    {
+        QJsonObject object = objects.value(io.first);
+        QString type_name = object["typename"].toString();
+        int width = 1;
+
+        if (_parser->schemas().contains(type_name))
+        {
+            SharedPtr<Schema> schema = _parser->schemas()[type_name];
+            const QList<QPair<ID, QString>>& ports = inputs ? schema->inputs() : schema->outputs();
+
+            for(int i = 0; i < ports.size(); i++)
+            {
+                if (ports[i].second == io.second)
+                {
+                    width = (inputs ? schema->inputWidths() : schema->outputWidths()).value(i, 1);
+                }
+            }
+        }
+        else
+        {
+            for(const QJsonValue& port : object[inputs ? "inputs" : "outputs"].toArray())
+            {
+                QString name;
+                int port_width;
+
+                if (parseDeclaration(port.toString(), &name, &port_width) && name == io.second)
+                {
+                    width = port_width;
+                }
+            }
+        }
+
+        widths.append(width);
+    }
+
+    return widths;
+}
+
+QStringList ParserImpl::parseIO(const QJsonValue& value, QVector<int>* widths, Diagnostics& diagnostics)
 {
     if (!value.isArray())
     {
-        _parser->error("Input/Output is not an array", {});
-        throw FatalParseException();
+        diagnostics.error("Input/Output is not an array", {});
+        diagnostics.fatal = true;
+        return QStringList();
     }
     else
     {
         QStringList ios;
+        QSet<QString> unique;
         QJsonArray array = value.toArray();
 
         for(const QJsonValue& io : array)
         {
             if (!io.isString())
             {
-                _parser->error("Input/Output is not a string", {});
+                diagnostics.error("Input/Output is not a string", {});
             }
             else
             {
-                QString io_name = io.toString();
+                QString io_name;
+                int width;
 
-                if (ios.contains(io_name))
+                if (!parseDeclaration(io.toString(), &io_name, &width))
                 {
-                    _parser->error("Input/Output name is not unique: %1", { io_name });
+                    diagnostics.error("Invalid Input/Output: \"%1\", expected a name or name[width] with width from 1 to %2",
+                                      { io.toString(), QString::number(_max_width) });
+                }
+                else if (unique.contains(io_name))
+                {
+                    diagnostics.error("Input/Output name is not unique: %1", { io_name });
                 }
                 else
                 {
+                    unique.insert(io_name);
                     ios.append(io_name);
+                    widths->append(width);
                 }
             }
         }
@@ -290,6 +928,68 @@ QStringList ParserImpl::parseIO(QJsonValue& value)
     }
 }
 
+// "name" declares a single bit, "name[width]" a bus.
+bool ParserImpl::parseDeclaration(const QString& text, QString* name, int* width)
+{
+    int open = text.indexOf('[');
+    bool ok = true;
+
+    if (open == -1)
+    {
+        *name = text;
+        *width = 1;
+    }
+    else if (text.endsWith(']'))
+    {
+        *name = text.left(open);
+        *width = text.mid(open + 1, text.size() - open - 2).toInt(&ok);
+    }
+    else
+    {
+        ok = false;
+    }
+
+    return ok && !name->isEmpty() && *width >= 1 && *width <= _max_width;
+}
+
+// "name" selects a whole port, "name[bit]" one bit and "name[msb:lsb]" a
+// slice. The width of a whole port is filled in by validate().
+bool ParserImpl::parseReference(const QString& text, QString* name, int* lsb, int* width)
+{
+    int open = text.indexOf('[');
+
+    if (open == -1)
+    {
+        *name = text;
+        *lsb = 0;
+        *width = -1;
+        return !name->isEmpty();
+    }
+
+    if (!text.endsWith(']'))
+    {
+        return false;
+    }
+
+    QStringList bounds = text.mid(open + 1, text.size() - open - 2).split(':');
+    bool msb_ok = false, lsb_ok = false;
+    int msb = bounds.first().toInt(&msb_ok);
+
+    *name = text.left(open);
+    *lsb = bounds.size() == 2 ? bounds.last().toInt(&lsb_ok) : msb;
+
+    // No port is wider than _max_width, so larger bit indexes are rejected
+    // here and the range checks in validate() cannot overflow.
+    if (!msb_ok || (!lsb_ok && bounds.size() != 1) || bounds.size() > 2 || name->isEmpty()
+            || *lsb < 0 || msb < *lsb || msb >= _max_width)
+    {
+        return false;
+    }
+
+    *width = msb - *lsb + 1;
+    return true;
+}
+
 QString ParserImpl::parseTypeName(QJsonValue& type)
 {
     if (!type.isString())
@@ -303,7 +1003,8 @@ QString ParserImpl::parseTypeName(QJsonValue& type)
 
         if(_parser->schemas().contains(name)
                 || _monophase_schema.contains(name)
-                || _multiphase_schema.contains(name))
+                || _multiphase_schema.contains(name)
+                || _sequential_schema.contains(name))
         {
             _parser->error("Schema with type \"%1\" is already declared or default", { name });
         }
@@ -312,6 +1013,10 @@ QString ParserImpl::parseTypeName(QJsonValue& type)
     }
 }
 
+// Blocks are converted in chunks on a thread pool. Whatever depends on
+// other blocks, duplicate IDs and the instantiation of parameterised
+// schemas, is done while the results are collected in source order, so the
+// diagnostics are the same as for a serial conversion.
 QMap<ID, SharedPtr<Block>> ParserImpl::parseBlocks(QJsonValue& value)
 {
     if (!value.isArray())
@@ -322,126 +1027,199 @@ QMap<ID, SharedPtr<Block>> ParserImpl::parseBlocks(QJsonValue& value)
     else
     {
         QMap<ID, SharedPtr<Block>> blocks;
+        QJsonArray array = value.toArray();
+        QVector<ParsedBlock> parsed(array.size());
 
-        for(const QJsonValue& block : value.toArray())
+        forChunks(array.size(), [&](int begin, int end)
         {
-            if (!block.isObject())
+            for(int i = begin; i < end; i++)
             {
-                _parser->error("Block is not an object", {});
+                parseBlock(array.at(i), parsed[i]);
             }
-            else
+        });
+
+        for(ParsedBlock& element : parsed)
+        {
+            if (element.has_id && blocks.contains(element.id))
             {
-                QJsonObject object = block.toObject();
-                QStringList fields = object.keys();
+                _parser->error("Property \"id\" of block is not a non-negative int", {});
+                continue;
+            }
 
-                bool valid = true;
+            report(element.diagnostics);
 
-                for(const QString& field : _block_fields)
-                {
-                    if(!fields.contains(field))
-                    {
-                        _parser->error("Block does not contains property: \"%1\"", {field});
-                        valid = false;
-                        break;
-                    }
-                }
+            if (!element.block)
+            {
+                continue;
+            }
+
+            if (!element.arguments.isUndefined())
+            {
+                QString type_val = parseArguments(element.block->typeName(), element.arguments);
 
-                if (!valid)
+                if (type_val.isEmpty())
                 {
                     continue;
                 }
 
-                SharedPtr<Block> block = std::make_shared<Block>();
+                setInterface(element.block, type_val);
+            }
 
-                QJsonValue id = object["id"];
-                QJsonValue type = object["typename"];
+            blocks.insert(element.id, element.block);
+        }
 
-                if(!id.isDouble())
-                {
-                    _parser->error("Property \"id\" of block is not a number", {});
-                    continue;
-                }
-                else if (blocks.contains(id.toInt()))
-                {
-                    _parser->error("Property \"id\" of block is not a non-negative int", {});
-                    continue;
-                }
+        return blocks;
+    }
+}
 
-                // To Do verify Type
-                if(!type.isString())
-                {
-                    _parser->error("Property \"typename\" is not a string", { });
-                    continue;
-                }
-                else
-                {
-                    QString type_val = type.toString();
-                    block->setTypeName(type_val);
+void ParserImpl::parseBlock(const QJsonValue& value, ParsedBlock& parsed)
+{
+    Diagnostics& diagnostics = parsed.diagnostics;
 
-                    if (_monophase_schema.contains(type_val))
-                    {
-                        QJsonValue inputs =  object["inputs"];
-                        QJsonValue outputs = object["outputs"];
+    if (!value.isObject())
+    {
+        diagnostics.error("Block is not an object", {});
+        return;
+    }
 
-                        block->setInputs(parseIO(inputs));
-                        block->setOutputs(parseIO(outputs));
+    QJsonObject object = value.toObject();
 
-                        if (block->inputs().size() != 1
-                            || block->outputs().size() != 1)
-                        {
-                            _parser->error("Monophase schema does not containts 1 input and 1 output", {});
-                            throw FatalParseException();
-                        }
+    for(const QString& field : _block_fields)
+    {
+        if(!object.contains(field))
+        {
+            diagnostics.error("Block does not contains property: \"%1\"", {field});
+            return;
+        }
+    }
 
-                        block->setType(BlockType::MONOPHASE);
-                    }
-                    else if (_multiphase_schema.contains(type_val))
-                    {
-                        QJsonValue inputs =  object["inputs"];
-                        QJsonValue outputs = object["outputs"];
+    SharedPtr<Block> block = std::make_shared<Block>();
 
-                        block->setInputs(parseIO(inputs));
-                        block->setOutputs(parseIO(outputs));
+    QJsonValue id = object["id"];
+    QJsonValue type = object["typename"];
 
-                        if (block->inputs().size() == 0 || block->outputs().size() != 1)
-                        {
-                            _parser->error("Multiphase schema does not containts any input or 1 output", {});
-                            throw FatalParseException();
-                        }
+    if(!id.isDouble())
+    {
+        diagnostics.error("Property \"id\" of block is not a number", {});
+        return;
+    }
 
-                        block->setType(BlockType::MULTIPHASE);
-                    }
-                    else if (_parser->schemas().contains(type_val))
-                    {
-                        QStringList inputs, outputs;
+    parsed.has_id = true;
+    parsed.id = id.toInt();
 
-                        for(const QPair<ID, QString>& input : _parser->schemas()[type_val]->inputs())
-                        {
-                            inputs.append(input.second);
-                        }
+    // To Do verify Type
+    if(!type.isString())
+    {
+        diagnostics.error("Property \"typename\" is not a string", { });
+        return;
+    }
 
-                        for(const QPair<ID, QString>& output : _parser->schemas()[type_val]->outputs())
-                        {
-                            outputs.append(output.second);
-                        }
+    QString type_val = type.toString();
+    block->setTypeName(type_val);
 
-                        block->setInputs(inputs);
-                        block->setOutputs(outputs);
-                        block->setType(BlockType::CUSTOM);
-                    }
-                    else
-                    {
-                        _parser->error("Unknown type: \"%1\"", {type_val});
-                        throw FatalParseException();
-                    }
-                }
+    if (_monophase_schema.contains(type_val) || _multiphase_schema.contains(type_val) || _sequential_schema.contains(type_val))
+    {
+        QVector<int> input_widths, output_widths;
 
-                blocks.insert(id.toInt(), block);
-            }
+        block->setInputs(parseIO(object["inputs"], &input_widths, diagnostics));
+
+        if (diagnostics.fatal)
+        {
+            return;
         }
 
-        return blocks;
+        block->setOutputs(parseIO(object["outputs"], &output_widths, diagnostics));
+
+        if (diagnostics.fatal)
+        {
+            return;
+        }
+
+        block->setInputWidths(input_widths);
+        block->setOutputWidths(output_widths);
+
+        if (_monophase_schema.contains(type_val)
+            && (block->inputs().size() != 1 || block->outputs().size() != 1))
+        {
+            diagnostics.error("Monophase schema does not containts 1 input and 1 output", {});
+            diagnostics.fatal = true;
+            return;
+        }
+
+        if (_multiphase_schema.contains(type_val)
+            && (block->inputs().size() == 0 || block->outputs().size() != 1))
+        {
+            diagnostics.error("Multiphase schema does not containts any input or 1 output", {});
+            diagnostics.fatal = true;
+            return;
+        }
+
+        if (_sequential_schema.contains(type_val)
+            && (block->inputs().size() != 1 || block->outputs().size() != 1))
+        {
+            diagnostics.error("Sequential schema does not containts 1 input and 1 output", {});
+            diagnostics.fatal = true;
+            return;
+        }
+
+        // A bus primitive applies its operation to every bit,
+        // so all of its ports must be equally wide.
+        if (input_widths.count(output_widths.first()) != input_widths.size())
+        {
+            diagnostics.error("Ports of block with id = %1 have different widths", { QString::number(id.toInt()) });
+            diagnostics.fatal = true;
+            return;
+        }
+
+        block->setType(_monophase_schema.contains(type_val) ? BlockType::MONOPHASE
+                     : _multiphase_schema.contains(type_val) ? BlockType::MULTIPHASE
+                     : BlockType::SEQUENTIAL);
+    }
+    else if (_parser->schemas().contains(type_val))
+    {
+        // Instantiation changes the parser, so it waits for the results
+        // to be collected.
+        if (object.contains("parameters"))
+        {
+            parsed.arguments = object["parameters"];
+        }
+        else
+        {
+            setInterface(block, type_val);
+        }
+
+        block->setType(BlockType::CUSTOM);
+    }
+    else
+    {
+        diagnostics.error("Unknown type: \"%1\"", {type_val});
+        diagnostics.fatal = true;
+        return;
+    }
+
+    parsed.block = block;
+}
+
+void ParserImpl::setInterface(const SharedPtr<Block>& block, const QString& type_name)
+{
+    SharedPtr<Schema> schema = _parser->schemas().value(type_name);
+    QStringList inputs, outputs;
+
+    for(const QPair<ID, QString>& input : schema->inputs())
+    {
+        inputs.append(input.second);
     }
+
+    for(const QPair<ID, QString>& output : schema->outputs())
+    {
+        outputs.append(output.second);
+    }
+
+    block->setTypeName(type_name);
+    block->setInputs(inputs);
+    block->setOutputs(outputs);
+    block->setInputWidths(schema->inputWidths());
+    block->setOutputWidths(schema->outputWidths());
 }
 
 QList<SharedPtr<Connection>> ParserImpl::parseConnections(QJsonValue& value)
@@ -455,75 +1233,102 @@ QList<SharedPtr<Connection>> ParserImpl::parseConnections(QJsonValue& value)
     {
         QList<SharedPtr<Connection>> connections;
         QJsonArray array = value.toArray();
+        QVector<SharedPtr<Connection>> parsed(array.size());
+        QVector<Diagnostics> diagnostics(array.size());
 
-        for(const QJsonValue& connection : array)
+        forChunks(array.size(), [&](int begin, int end)
         {
-            if (!connection.isObject())
+            for(int i = begin; i < end; i++)
             {
-                _parser->error("Property \"connections\" is not an object", {});
+                parsed[i] = parseConnection(array.at(i), diagnostics[i]);
             }
-            else
+        });
+
+        for(int i = 0; i < parsed.size(); i++)
+        {
+            report(diagnostics[i]);
+
+            if (parsed[i])
             {
-                QJsonObject object = connection.toObject();
-                QStringList fields = object.keys();
+                connections.append(parsed[i]);
+            }
+        }
 
-                bool valid = true;
+        return connections;
+    }
+}
 
-                for(const QString& field : _connection_fields)
-                {
-                    if (!fields.contains(field))
-                    {
-                        _parser->error("Connection does not contains property: \"%1\"", {field});
-                        valid = false;
-                        break;
-                    }
-                }
+SharedPtr<Connection> ParserImpl::parseConnection(const QJsonValue& value, Diagnostics& diagnostics)
+{
+    if (!value.isObject())
+    {
+        diagnostics.error("Property \"connections\" is not an object", {});
+        return nullptr;
+    }
 
-                if (!valid)
-                {
-                    continue;
-                }
+    QJsonObject object = value.toObject();
 
-                QJsonValue input_id = object["input-id"];
-                QJsonValue input_name = object["input-name"];
-                QJsonValue output_id = object["output-id"];
-                QJsonValue output_name = object["output-name"];
+    for(const QString& field : _connection_fields)
+    {
+        if (!object.contains(field))
+        {
+            diagnostics.error("Connection does not contains property: \"%1\"", {field});
+            return nullptr;
+        }
+    }
 
-                if (!input_id.isDouble() || input_id.toInt() < 0)
-                {
-                    _parser->error("Property in connection: \"input-id\" is not a number", {});
-                    continue;
-                }
+    QJsonValue input_id = object["input-id"];
+    QJsonValue input_name = object["input-name"];
+    QJsonValue output_id = object["output-id"];
+    QJsonValue output_name = object["output-name"];
 
-                if (!input_name.isString())
-                {
-                    _parser->error("Property in connection: \"input-name\" is not a string", {});
-                    continue;
-                }
+    if (!input_id.isDouble() || input_id.toInt() < 0)
+    {
+        diagnostics.error("Property in connection: \"input-id\" is not a number", {});
+        return nullptr;
+    }
 
-                if (!output_id.isDouble() || output_id.toInt() < 0)
-                {
-                    _parser->error("Property in connection: \"input-id\" is not a number", {});
-                    continue;
-                }
+    if (!input_name.isString())
+    {
+        diagnostics.error("Property in connection: \"input-name\" is not a string", {});
+        return nullptr;
+    }
 
-                if (!output_name.isString())
-                {
-                    _parser->error("Property in connection: \"output-name\" is not a string", {});
-                    continue;
-                }
+    if (!output_id.isDouble() || output_id.toInt() < 0)
+    {
+        diagnostics.error("Property in connection: \"input-id\" is not a number", {});
+        return nullptr;
+    }
 
-                SharedPtr<Connection> conn = std::make_shared<Connection>();
+    if (!output_name.isString())
+    {
+        diagnostics.error("Property in connection: \"output-name\" is not a string", {});
+        return nullptr;
+    }
 
-                conn->setInputId(input_id.toInt());
-                conn->setInputName(input_name.toString());
-                conn->setOuputId(output_id.toInt());
-                conn->setOutputName(output_name.toString());
+    QString input_port, output_port;
+    int input_lsb, input_width, output_lsb, output_width;
 
-                connections.append(conn);
-            }
-        }
+    if (!parseReference(input_name.toString(), &input_port, &input_lsb, &input_width))
+    {
+        diagnostics.error("Property in connection: \"input-name\" is not a port, bit or slice: \"%1\"", { input_name.toString() });
+        return nullptr;
+    }
 
-        return connections;
+    if (!parseReference(output_name.toString(), &output_port, &output_lsb, &output_width))
+    {
+        diagnostics.error("Property in connection: \"output-name\" is not a port, bit or slice: \"%1\"", { output_name.toString() });
+        return nullptr;
     }
+
+    SharedPtr<Connection> conn = std::make_shared<Connection>();
+
+    conn->setInputId(input_id.toInt());
+    conn->setInputName(input_port);
+    conn->setInputSlice(input_lsb, input_width);
+    conn->setOuputId(output_id.toInt());
+    conn->setOutputName(output_port);
+    conn->setOutputSlice(output_lsb, output_width);
+
+    return conn;
 }
@@ -4,8 +4,11 @@
 #include "../general/schema.h"
 #include "fatalparseexception.h"
 
+#include <QJsonObject>
 #include <QJsonValue>
 
+#include <functional>
+
 class Parser;
 
 class ParserImpl
@@ -17,25 +20,75 @@ private:
 
     static const QStringList _monophase_schema;
     static const QStringList _multiphase_schema;
+    static const QStringList _sequential_schema;
+
+    static const int _max_width;
+    static const qint64 _max_repeat;
+    static const int _chunk_size;
+
+    // Messages of one element, kept until the elements are merged in
+    // source order.
+    struct Diagnostics
+    {
+        QList<QPair<QString, QStringList>> errors;
+        bool fatal = false;
+
+        void error(const QString&, const QStringList&);
+    };
+
+    struct ParsedBlock
+    {
+        Diagnostics diagnostics;
+        bool has_id = false;
+        ID id = 0;
+        SharedPtr<Block> block;
+        QJsonValue arguments = QJsonValue(QJsonValue::Undefined);
+    };
 
 public:
     ParserImpl(Parser*);
     ~ParserImpl();
 
-    void parse(const QString&);
+    QStringList open(const QString&, bool dependencies_only);
+    void parse();
+    SharedPtr<Schema> instantiate(const SharedPtr<Schema>&, const QMap<QString, qint64>&, const QString& type_name);
 
 private:
-    void parseJson(const QString&, const QByteArray&);
+    QByteArray read(const QString&);
+    bool decode(const QByteArray&, QJsonObject&);
+    SharedPtr<Schema> convert(const QMap<QString, qint64>&, bool interface_only);
+    void validate(const SharedPtr<Schema>&);
+
+    QMap<QString, qint64> parseParameters(QJsonValue&);
+    QString parseArguments(const QString&, QJsonValue&);
+    QJsonValue expand(const QJsonValue&);
+    QJsonValue substitute(const QJsonValue&);
+    QString interpolate(const QString&);
+    bool evaluate(const QJsonValue&, qint64*);
+
+    void forChunks(int count, const std::function<void(int, int)>&);
+    void report(const Diagnostics&);
 
-    void parseUsing(QJsonValue&, const QString&);
+    QStringList parseUsing(QJsonValue&, const QString&);
     QList<QPair<ID, QString>> parseGlobalIO(QJsonValue&);
-    QStringList parseIO(QJsonValue&);
+    QVector<int> parseInterfaceWidths(const QList<QPair<ID, QString>>&, QJsonValue&, bool inputs);
+    QStringList parseIO(const QJsonValue&, QVector<int>*, Diagnostics&);
+    bool parseDeclaration(const QString&, QString*, int*);
+    bool parseReference(const QString&, QString*, int*, int*);
     QString parseTypeName(QJsonValue&);
     QMap<ID, SharedPtr<Block>> parseBlocks(QJsonValue&);
+    void parseBlock(const QJsonValue&, ParsedBlock&);
+    void setInterface(const SharedPtr<Block>&, const QString&);
     QList<SharedPtr<Connection>> parseConnections(QJsonValue&);
+    SharedPtr<Connection> parseConnection(const QJsonValue&, Diagnostics&);
 
 private:
     Parser* _parser;
+    QJsonObject _object;
+    bool _decoded;
+    bool _parameterised;
+    QMap<QString, qint64> _scope;
+    QString _type_name;
 };
 
 #endif // PARSERIMPL_H
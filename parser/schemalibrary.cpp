@@ -0,0 +1,56 @@
+#include "schemalibrary.h"
+
+#include "parser.h"
+
+SchemaLibrary::SchemaLibrary(const Parser& parser)
+{
+    for(auto it = parser.files().constBegin(); it != parser.files().constEnd(); ++it)
+    {
+        if (!parser.failed().contains(it.key()))
+        {
+            _files.insert(it.key(), it.value());
+            _schemas.insert(it.value()->typeName(), it.value());
+            _dependencies.insert(it.key(), parser.dependencies().value(it.key()));
+            _instances.insert(it.key(), parser.instances().value(it.key()));
+
+            for(const QString& instance : _instances.value(it.key()))
+            {
+                _schemas.insert(instance, parser.schemas().value(instance));
+            }
+        }
+    }
+}
+
+SchemaLibrary::~SchemaLibrary()
+{
+}
+
+bool SchemaLibrary::contains(const QString& absolute_path) const
+{
+    return _files.contains(absolute_path);
+}
+
+SharedPtr<Schema> SchemaLibrary::file(const QString& absolute_path) const
+{
+    return _files.value(absolute_path);
+}
+
+QStringList SchemaLibrary::dependencies(const QString& absolute_path) const
+{
+    return _dependencies.value(absolute_path);
+}
+
+QStringList SchemaLibrary::instances(const QString& absolute_path) const
+{
+    return _instances.value(absolute_path);
+}
+
+const QMap<QString, SharedPtr<Schema>>& SchemaLibrary::files() const
+{
+    return _files;
+}
+
+const QMap<QString, SharedPtr<Schema>>& SchemaLibrary::schemas() const
+{
+    return _schemas;
+}
@@ -0,0 +1,35 @@
+#ifndef SCHEMALIBRARY_H
+#define SCHEMALIBRARY_H
+
+#include "../general/schema.h"
+
+#include <QMap>
+#include <QStringList>
+
+class Parser;
+
+// Snapshot of the files a Parser has read without errors. It is never
+// modified after construction, so one instance can be shared by parsers
+// running on different threads without locking.
+class SchemaLibrary
+{
+public:
+    SchemaLibrary(const Parser&);
+    ~SchemaLibrary();
+
+    bool contains(const QString& absolute_path) const;
+    SharedPtr<Schema> file(const QString& absolute_path) const;
+    QStringList dependencies(const QString& absolute_path) const;
+    QStringList instances(const QString& absolute_path) const;
+
+    const QMap<QString, SharedPtr<Schema>>& files() const;
+    const QMap<QString, SharedPtr<Schema>>& schemas() const;
+
+private:
+    QMap<QString, SharedPtr<Schema>> _files;
+    QMap<QString, SharedPtr<Schema>> _schemas;
+    QMap<QString, QStringList> _dependencies;
+    QMap<QString, QStringList> _instances;
+};
+
+#endif // SCHEMALIBRARY_H
@@ -0,0 +1,358 @@
+#include "profiler.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+static const char* const _counter_names[Profiler::counter_count] =
+{
+    "bytes read",
+    "blocks",
+    "connections",
+    "schemas",
+    "files written",
+    "bytes written"
+};
+
+struct OpenScope
+{
+    QString name;
+    qint64 start;
+    qint64 counters[Profiler::counter_count];
+};
+
+struct ReportNode
+{
+    QString name;
+    qint64 duration = 0;
+    int calls = 0;
+    qint64 counters[Profiler::counter_count] = {};
+    QList<ReportNode> children;
+};
+
+static std::atomic<int> _next_thread(0);
+static thread_local int _thread = _next_thread++;
+static thread_local QList<OpenScope> _open;
+
+static ReportNode& child(ReportNode& node, const QString& name)
+{
+    for(ReportNode& child : node.children)
+    {
+        if (child.name == name)
+        {
+            return child;
+        }
+    }
+
+    ReportNode child;
+    child.name = name;
+    node.children.append(child);
+    return node.children.last();
+}
+
+static void print(std::ostream& out, const ReportNode& node, int depth, qint64 total)
+{
+    QString counters;
+
+    for(int i = 0; i < Profiler::counter_count; i++)
+    {
+        if (node.counters[i] != 0)
+        {
+            counters += (counters.isEmpty() ? "  [" : ", ") + QString(_counter_names[i]) + ": " + QString::number(node.counters[i]);
+        }
+    }
+
+    if (!counters.isEmpty())
+    {
+        counters += "]";
+    }
+
+    QString line = QString("%1 ms %2% %3  %4%5%6")
+            .arg(node.duration / 1e6, 12, 'f', 3)
+            .arg(total > 0 ? 100.0 * node.duration / total : 0.0, 6, 'f', 1)
+            .arg(node.calls, 6)
+            .arg(QString(depth * 2, ' '), node.name, counters);
+
+    out << line.toStdString() << std::endl;
+
+    for(const ReportNode& child : node.children)
+    {
+        print(out, child, depth + 1, total);
+    }
+}
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler():
+    _enabled(false)
+{
+    _clock.start();
+
+    for(std::atomic<qint64>& total : _totals)
+    {
+        total = 0;
+    }
+}
+
+Profiler::~Profiler()
+{
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+    _enabled = enabled;
+}
+
+bool Profiler::isEnabled() const
+{
+    return _enabled;
+}
+
+void Profiler::reset()
+{
+    QMutexLocker lock(&_mutex);
+    _scopes.clear();
+
+    for(std::atomic<qint64>& total : _totals)
+    {
+        total = 0;
+    }
+}
+
+void Profiler::begin(const QString& name)
+{
+    OpenScope scope { name, _clock.nsecsElapsed(), {} };
+    _open.append(scope);
+}
+
+void Profiler::end()
+{
+    if (_open.isEmpty())
+    {
+        return;
+    }
+
+    OpenScope open = _open.takeLast();
+    Scope scope;
+
+    for(const OpenScope& parent : _open)
+    {
+        scope.path.append(parent.name);
+    }
+
+    scope.path.append(open.name);
+    scope.start = open.start;
+    scope.duration = _clock.nsecsElapsed() - open.start;
+    scope.thread = _thread;
+
+    for(int i = 0; i < counter_count; i++)
+    {
+        scope.counters[i] = open.counters[i];
+    }
+
+    QMutexLocker lock(&_mutex);
+    _scopes.append(scope);
+}
+
+void Profiler::add(Counter counter, qint64 value)
+{
+    if (!_enabled)
+    {
+        return;
+    }
+
+    int index = static_cast<int>(counter);
+    _totals[index] += value;
+
+    if (!_open.isEmpty())
+    {
+        _open.last().counters[index] += value;
+    }
+}
+
+qint64 Profiler::elapsed(const QString& name) const
+{
+    QMutexLocker lock(&_mutex);
+    qint64 duration = 0;
+
+    for(const Scope& scope : _scopes)
+    {
+        const QString& leaf = scope.path.last();
+
+        if (leaf == name || leaf.startsWith(name + " "))
+        {
+            duration += scope.duration;
+        }
+    }
+
+    return duration;
+}
+
+qint64 Profiler::total(Counter counter) const
+{
+    return _totals[static_cast<int>(counter)];
+}
+
+// Peak resident set size in bytes, or 0 where it is not available.
+qint64 Profiler::peakMemory()
+{
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+
+#if defined(Q_OS_MACOS)
+    return qint64(usage.ru_maxrss);
+#else
+    return qint64(usage.ru_maxrss) * 1024;
+#endif
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return 0;
+    }
+
+    return qint64(counters.PeakWorkingSetSize);
+#else
+    return 0;
+#endif
+}
+
+void Profiler::report(std::ostream& out) const
+{
+    ReportNode root;
+
+    {
+        QMutexLocker lock(&_mutex);
+
+        for(const Scope& scope : _scopes)
+        {
+            ReportNode* node = &root;
+
+            for(int i = 0; i < counter_count; i++)
+            {
+                node->counters[i] += scope.counters[i];
+            }
+
+            for(const QString& name : scope.path)
+            {
+                node = &child(*node, name);
+
+                for(int i = 0; i < counter_count; i++)
+                {
+                    node->counters[i] += scope.counters[i];
+                }
+            }
+
+            node->duration += scope.duration;
+            node->calls++;
+        }
+    }
+
+    for(const ReportNode& node : root.children)
+    {
+        root.duration += node.duration;
+    }
+
+    out << "===== Time report =====" << std::endl;
+    out << QString("Total: %1 ms, peak RSS: %2 MiB")
+           .arg(root.duration / 1e6, 0, 'f', 3)
+           .arg(peakMemory() / 1048576.0, 0, 'f', 1).toStdString() << std::endl;
+    out << "       time (ms)       %  calls  phase" << std::endl;
+
+    for(const ReportNode& node : root.children)
+    {
+        print(out, node, 0, root.duration);
+    }
+}
+
+bool Profiler::writeTrace(const QString& path) const
+{
+    QJsonArray events;
+
+    {
+        QMutexLocker lock(&_mutex);
+
+        for(const Scope& scope : _scopes)
+        {
+            QJsonObject args;
+
+            for(int i = 0; i < counter_count; i++)
+            {
+                if (scope.counters[i] != 0)
+                {
+                    args.insert(_counter_names[i], double(scope.counters[i]));
+                }
+            }
+
+            events.append(QJsonObject {
+                { "name", scope.path.last() },
+                { "cat", "lsc" },
+                { "ph", "X" },
+                { "ts", scope.start / 1e3 },
+                { "dur", scope.duration / 1e3 },
+                { "pid", 1 },
+                { "tid", scope.thread },
+                { "args", args }
+            });
+        }
+    }
+
+    QFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    file.write(QJsonDocument(QJsonObject {
+        { "traceEvents", events },
+        { "displayTimeUnit", "ms" }
+    }).toJson(QJsonDocument::Compact));
+    file.close();
+    return true;
+}
+
+ScopedTimer::ScopedTimer(const char* name):
+    _active(Profiler::instance().isEnabled())
+{
+    if (_active)
+    {
+        Profiler::instance().begin(name);
+    }
+}
+
+ScopedTimer::ScopedTimer(const char* name, const QString& detail):
+    _active(Profiler::instance().isEnabled())
+{
+    if (_active)
+    {
+        Profiler::instance().begin(QString(name) + " " + detail);
+    }
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    if (_active)
+    {
+        Profiler::instance().end();
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QStringList>
+
+#include <atomic>
+#include <ostream>
+
+enum class Counter
+{
+    BYTES_READ,
+    BLOCKS,
+    CONNECTIONS,
+    SCHEMAS,
+    FILES_WRITTEN,
+    BYTES_WRITTEN,
+    COUNT
+};
+
+class Profiler
+{
+public:
+    static constexpr int counter_count = static_cast<int>(Counter::COUNT);
+
+    static Profiler& instance();
+
+    void setEnabled(bool);
+    bool isEnabled() const;
+    void reset();
+
+    void begin(const QString&);
+    void end();
+    void add(Counter, qint64);
+
+    qint64 elapsed(const QString&) const;
+    qint64 total(Counter) const;
+    static qint64 peakMemory();
+
+    void report(std::ostream&) const;
+    bool writeTrace(const QString&) const;
+
+private:
+    struct Scope
+    {
+        QStringList path;
+        qint64 start;
+        qint64 duration;
+        int thread;
+        qint64 counters[counter_count];
+    };
+
+    Profiler();
+    ~Profiler();
+
+private:
+    std::atomic<bool> _enabled;
+    QElapsedTimer _clock;
+    mutable QMutex _mutex;
+    QList<Scope> _scopes;
+    std::atomic<qint64> _totals[counter_count];
+};
+
+class ScopedTimer
+{
+public:
+    ScopedTimer(const char*);
+    ScopedTimer(const char*, const QString&);
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    bool _active;
+};
+
+#endif // PROFILER_H
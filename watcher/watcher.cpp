@@ -0,0 +1,188 @@
+#include "watcher.h"
+
+#include "../analysis/reachability.h"
+#include "../analysis/structuralhash.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
+
+#include <iostream>
+
+Watcher::Watcher(const QString& input, const QString& output, bool lazy, const GeneratorOptions& options, QObject* parent):
+    QObject(parent),
+    _input(QFileInfo(input).absoluteFilePath()),
+    _output(output)
+{
+    _parser.setLazy(lazy);
+    _generator.setOptions(options);
+    _debounce.setSingleShot(true);
+    _debounce.setInterval(50);
+
+    connect(&_watcher, &QFileSystemWatcher::fileChanged, this, &Watcher::fileChanged);
+    connect(&_watcher, &QFileSystemWatcher::directoryChanged, this, &Watcher::directoryChanged);
+    connect(&_debounce, &QTimer::timeout, this, &Watcher::rebuild);
+}
+
+Watcher::~Watcher()
+{
+}
+
+void Watcher::start()
+{
+    _generator.loadManifest(_output);
+    build({});
+    std::cout << "Watching " << _parser.dependencies().size() << " file(s) for changes" << std::endl;
+}
+
+void Watcher::fileChanged(const QString& path)
+{
+    _changed.insert(path);
+    _debounce.start();
+}
+
+void Watcher::directoryChanged(const QString& path)
+{
+    for(const QString& file : _parser.dependencies().keys())
+    {
+        QFileInfo info(file);
+
+        if (info.absolutePath() == path && info.exists() && !_watcher.files().contains(file))
+        {
+            _changed.insert(file);
+            _debounce.start();
+        }
+    }
+}
+
+void Watcher::rebuild()
+{
+    QStringList changed = _changed.values();
+    _changed.clear();
+    build(changed);
+}
+
+void Watcher::build(const QStringList& changed)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 edited = QDateTime::currentMSecsSinceEpoch();
+    QSet<QString> invalidated;
+
+    for(const QString& file : changed)
+    {
+        QFileInfo info(file);
+
+        if (info.exists())
+        {
+            edited = qMin(edited, info.lastModified().toMSecsSinceEpoch());
+        }
+
+        for(const QString& path : _parser.invalidate(file))
+        {
+            invalidated.insert(path);
+        }
+    }
+
+    bool parsed = _parser.parse(_input);
+    watchFiles();
+
+    if (!parsed || !_parser.mainSchema())
+    {
+        std::cout << "Compilation aborted due to errors, waiting for changes" << std::endl;
+        return;
+    }
+
+    Reachability reachability(_parser.mainSchema(), _parser.schemas());
+    const QMap<QString, SharedPtr<Schema>>& schemas = reachability.reachable();
+    QMap<QString, QString> representatives;
+    QList<SharedPtr<Schema>> regenerated;
+    QStringList removed;
+
+    if (_generator.options().dedup)
+    {
+        representatives = StructuralHash(schemas).representatives();
+        _generator.setRepresentatives(representatives);
+    }
+
+    for(const SharedPtr<Schema>& schema : schemas)
+    {
+        if (_generated.value(schema->typeName()) != schema
+                || _representatives.value(schema->typeName()) != representatives.value(schema->typeName()))
+        {
+            regenerated.append(schema);
+        }
+    }
+
+    for(const QString& type_name : _generated.keys())
+    {
+        if (!schemas.contains(type_name))
+        {
+            removed.append(type_name);
+        }
+    }
+
+    if (_generated.keys() != schemas.keys() || _main_type != _parser.mainSchema()->typeName())
+    {
+        _generator.generateProject(_output, _parser.mainSchema(), schemas);
+    }
+
+    _generator.generateSchemas(_output, regenerated);
+    _generator.removeSchemas(_output, removed);
+
+    if (!regenerated.isEmpty() && !_generator.generateSimulation(_output, _parser.mainSchema(), schemas))
+    {
+        std::cout << "Batch simulator not generated: " << _generator.simulationError().toStdString() << std::endl;
+    }
+
+    if (!regenerated.isEmpty() && _generator.options().static_backend)
+    {
+        _generator.generateStaticDesign(_output, _parser.mainSchema(), schemas);
+
+        for(const QString& warning : _generator.memoizeWarnings())
+        {
+            std::cerr << warning.toStdString() << std::endl;
+        }
+    }
+
+    for(const QString& error : _generator.takeWriteErrors())
+    {
+        std::cerr << error.toStdString() << std::endl;
+    }
+
+    _generator.saveManifest(_output);
+    _generated = schemas;
+    _representatives = representatives;
+    _main_type = _parser.mainSchema()->typeName();
+
+    if (changed.isEmpty())
+    {
+        std::cout << "Compilation finished: " << regenerated.size() << " header(s) in "
+                  << timer.elapsed() << " ms" << std::endl;
+    }
+    else
+    {
+        std::cout << "Rebuilt " << invalidated.size() << " file(s), regenerated " << regenerated.size()
+                  << " header(s) in " << timer.elapsed() << " ms, edit-to-output latency "
+                  << QDateTime::currentMSecsSinceEpoch() - edited << " ms" << std::endl;
+    }
+}
+
+void Watcher::watchFiles()
+{
+    for(const QString& file : _parser.dependencies().keys())
+    {
+        QFileInfo info(file);
+
+        if (info.exists() && !_watcher.files().contains(file))
+        {
+            _watcher.addPath(file);
+        }
+
+        if (!_watcher.directories().contains(info.absolutePath()))
+        {
+            _watcher.addPath(info.absolutePath());
+        }
+    }
+}
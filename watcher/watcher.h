@@ -0,0 +1,43 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include "../parser/parser.h"
+#include "../generator/generator.h"
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QTimer>
+
+class Watcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    Watcher(const QString& input, const QString& output, bool lazy, const GeneratorOptions& options, QObject* parent = nullptr);
+    ~Watcher();
+
+    void start();
+
+private slots:
+    void fileChanged(const QString&);
+    void directoryChanged(const QString&);
+    void rebuild();
+
+private:
+    void build(const QStringList&);
+    void watchFiles();
+
+private:
+    QString _input;
+    QString _output;
+    Parser _parser;
+    Generator _generator;
+    QFileSystemWatcher _watcher;
+    QTimer _debounce;
+    QSet<QString> _changed;
+    QString _main_type;
+    QMap<QString, SharedPtr<Schema>> _generated;
+    QMap<QString, QString> _representatives;
+};
+
+#endif // WATCHER_H